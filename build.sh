@@ -9,7 +9,10 @@ mkdir -p build
 mkdir -p build/idt
 mkdir -p build/memory
 mkdir -p build/memory/heap
+mkdir -p build/memory/frame
+mkdir -p build/memory/e820
 mkdir -p build/memory/paging
+mkdir -p build/memory/vm
 mkdir -p build/io
 mkdir -p build/disk
 mkdir -p build/string
@@ -19,6 +22,7 @@ mkdir -p build/gdt
 mkdir -p build/task
 mkdir -p build/isr80h
 mkdir -p build/keyboard
+mkdir -p build/timer
 mkdir -p build/loader/formats
 
 # build folder for programs
@@ -47,7 +51,7 @@ make all && qemu-system-i386 -hda bin/os.bin
 # gdb commands: c (continue), layout asm, info registers
 # cd bin
 # gdb
-# add-symbol-file ../build/kernelfull.o 0x100000
+# add-symbol-file ../build/kernelfull.o 0xC0102000
 # break _start
 # target remote | qemu-system-x86_64 -S -gdb stdio -hda os.bin
 # OR: target remote | qemu-system-i386 -S -gdb stdio -hda os.bin
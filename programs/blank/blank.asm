@@ -7,7 +7,7 @@ global _start
 _start:
     ; print message1
     mov eax, message1
-    call print_pop
+    call print_message
 
     ; wait for a keypress
 next_key:
@@ -17,25 +17,23 @@ next_key:
     je done
 
     ; write character
-    push eax ; save the key onto the stack
+    mov ebx, eax ; 1st argument (the key) goes in ebx
     mov eax, 3 ; execute command #3 (putchar)
     int 0x80
-    pop eax ; pop the key
     jmp next_key
 
 done:
     ; print message2
     mov eax, message2
-    call print_pop
+    call print_message
 
     ; infinite loop
     jmp $
 
-print_pop:
-    push eax ; 1st argument is passed in eax
+print_message:
+    mov ebx, eax ; message is passed in eax, but the kernel wants its 1st argument in ebx
     mov eax, 1 ; kernel print command
     int 0x80
-    add esp, 4 ; pop argument
     ret
 
 getkey:
@@ -10,8 +10,8 @@ int main( int argc, char** argv ) {
         for( int i = 0; i < argc; i++ ) { print( argv[i] ); if( i < argc - 1 ) print( "," ); }
         print( "\n" );
 
-        // long loop
-        for( int i = 0; i < 500000000; i++ );
+        // wait a while (w/o burning the cpu)
+        peachos_sleep_ms( 1000 );
     }
 
     /*
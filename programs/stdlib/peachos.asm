@@ -2,8 +2,12 @@
 
 section .asm ; safer to use this to avoid alignment issues that would happen if we mixed this with C object code
 
+; kernel calls: eax = command, arguments in ebx, ecx, edx, esi, edi (in that order), result in eax
+; (ebx, esi & edi belong to the caller in C, so wrappers must save any they use)
+
 global print:function
 global peachos_getkey:function
+global peachos_getkey_block:function
 global peachos_malloc:function
 global peachos_free:function
 global peachos_putchar:function
@@ -11,6 +15,71 @@ global peachos_process_load_start:function
 global peachos_process_get_arguments:function
 global peachos_system:function
 global peachos_exit:function
+global peachos_fork:function
+global peachos_idle_percent:function
+global peachos_sleep_ms:function
+global peachos_nanosleep:function
+global peachos_clock_gettime:function
+global peachos_rdtsc:function
+global peachos_div64:function
+
+; every wrapper enters the kernel through peachos_kernel_call, which is picked on the 1st call:
+; sysenter if the cpu has it (much cheaper than an interrupt), otherwise int 0x80
+section .data
+peachos_kernel_call: dd peachos_kernel_call_detect
+
+section .asm
+
+peachos_kernel_call_detect:
+    ; save the registers we use (eax & ebx carry the kernel call)
+    push eax
+    push ebx
+    push ecx
+    push edx
+
+    ; no cpuid (i.e. the ID flag in eflags can't be toggled) means no sysenter either
+    mov ecx, peachos_kernel_call_int80
+    pushfd
+    pop eax
+    mov edx, eax
+    xor eax, 0x200000
+    push eax
+    popfd
+    pushfd
+    pop eax
+    cmp eax, edx
+    je .pick
+
+    ; cpuid leaf 1: edx bit 11 = SEP (sysenter/sysexit)
+    mov eax, 1
+    cpuid
+    mov ecx, peachos_kernel_call_int80
+    bt edx, 11
+    jnc .pick
+    mov ecx, peachos_kernel_call_sysenter
+
+.pick:
+    ; remember the choice, then make this call w/ it
+    mov [peachos_kernel_call], ecx
+    pop edx
+    pop ecx
+    pop ebx
+    pop eax
+    jmp [peachos_kernel_call]
+
+peachos_kernel_call_int80:
+    int 0x80
+    ret
+
+; the kernel returns to the address on top of the stack in ebp (sysenter itself doesn't save eip or esp), & trashes ecx & edx
+peachos_kernel_call_sysenter:
+    push ebp
+    push .return
+    mov ebp, esp
+    sysenter
+.return:
+    pop ebp
+    ret
 
 ; void print( const char* message );
 print:
@@ -20,9 +89,10 @@ print:
 
     ; body
     mov eax, 1 ; command 'print'
-    push dword[ebp + 8] ; arg #1
-    int 0x80 ; syscall
-    add esp, 4 ; pop args
+    push ebx ; callee-saved
+    mov ebx, [ebp + 8] ; arg #1
+    call [peachos_kernel_call] ; syscall
+    pop ebx
 
     ; destroy stack frame
     pop ebp
@@ -36,7 +106,21 @@ peachos_getkey:
 
     ; body
     mov eax, 2 ; command 'getkey'
-    int 0x80 ; note that eax contains return value, and in C the convention is that eax contains return value if it can fit into 4 bytes
+    call [peachos_kernel_call] ; note that eax contains return value, and in C the convention is that eax contains return value if it can fit into 4 bytes
+
+    ; destroy stack frame
+    pop ebp
+    ret
+
+; int peachos_getkey_block(); (the kernel puts us to sleep until a key arrives, rather than us polling)
+peachos_getkey_block:
+    ; create stack frame
+    push ebp
+    mov ebp, esp
+
+    ; body
+    mov eax, 12 ; command 'getkey_block'
+    call [peachos_kernel_call]
 
     ; destroy stack frame
     pop ebp
@@ -50,9 +134,10 @@ peachos_putchar:
 
     ; body
     mov eax, 3 ; command 'putchar'
-    push dword[ebp + 8] ; arg #1
-    int 0x80 ; syscall
-    add esp, 4 ; pop args
+    push ebx ; callee-saved
+    mov ebx, [ebp + 8] ; arg #1
+    call [peachos_kernel_call] ; syscall
+    pop ebx
 
     ; destroy stack frame
     pop ebp
@@ -66,9 +151,10 @@ peachos_malloc:
     
     ; body
     mov eax, 4 ; command 'malloc'
-    push dword[ebp + 8]; push arg #1
-    int 0x80
-    add esp, 4 ; pop args
+    push ebx ; callee-saved
+    mov ebx, [ebp + 8] ; arg #1
+    call [peachos_kernel_call]
+    pop ebx
 
     ; destroy stack frame
     pop ebp
@@ -82,9 +168,10 @@ peachos_free:
     
     ; body
     mov eax, 5 ; command 'free'
-    push dword[ebp + 8]; push arg #1
-    int 0x80
-    add esp, 4 ; pop args
+    push ebx ; callee-saved
+    mov ebx, [ebp + 8] ; arg #1
+    call [peachos_kernel_call]
+    pop ebx
 
     ; destroy stack frame
     pop ebp
@@ -97,9 +184,10 @@ peachos_process_load_start:
     
     ; body
     mov eax, 6 ; command 'process_load_start'
-    push dword[ebp + 8]; push arg #1 'filename'
-    int 0x80
-    add esp, 4 ; pop args
+    push ebx ; callee-saved
+    mov ebx, [ebp + 8] ; arg #1 'filename'
+    call [peachos_kernel_call]
+    pop ebx
 
     ; destroy stack frame
     pop ebp
@@ -113,9 +201,10 @@ peachos_system:
 
     ; body
     mov eax, 7 ; command 'peachos_system'
-    push dword[ebp + 8]; push arg #1 'arguments'
-    int 0x80
-    add esp, 4 ; pop args
+    push ebx ; callee-saved
+    mov ebx, [ebp + 8] ; arg #1 'arguments'
+    call [peachos_kernel_call]
+    pop ebx
 
     ; destroy stack frame
     pop ebp
@@ -129,9 +218,10 @@ peachos_process_get_arguments:
     
     ; body
     mov eax, 8 ; command 'get_program_arguments'
-    push dword[ebp + 8]; push arg #1 'process_arguments*'
-    int 0x80
-    add esp, 4 ; pop args
+    push ebx ; callee-saved
+    mov ebx, [ebp + 8] ; arg #1 'process_arguments*'
+    call [peachos_kernel_call]
+    pop ebx
 
     ; destroy stack frame
     pop ebp
@@ -145,8 +235,113 @@ peachos_exit:
     
     ; body
     mov eax, 9 ; command 'exit'
-    int 0x80
+    call [peachos_kernel_call]
 
     ; destroy stack frame
     pop ebp
     ret
+
+; int peachos_fork();
+peachos_fork:
+    ; create stack frame
+    push ebp
+    mov ebp, esp
+
+    ; body
+    mov eax, 10 ; command 'fork'
+    call [peachos_kernel_call] ; eax = 0 in the child, child's process id in the parent
+
+    ; destroy stack frame
+    pop ebp
+    ret
+
+; int peachos_idle_percent();
+peachos_idle_percent:
+    ; create stack frame
+    push ebp
+    mov ebp, esp
+
+    ; body
+    mov eax, 11 ; command 'idle_percent'
+    call [peachos_kernel_call]
+
+    ; destroy stack frame
+    pop ebp
+    ret
+
+; void peachos_sleep_ms( unsigned int ms );
+peachos_sleep_ms:
+    ; create stack frame
+    push ebp
+    mov ebp, esp
+    push ebx
+
+    ; body
+    mov eax, 13 ; command 'sleep_ms'
+    mov ebx, [ebp+8] ; ms
+    call [peachos_kernel_call]
+
+    ; destroy stack frame
+    pop ebx
+    pop ebp
+    ret
+
+; int peachos_nanosleep( const struct timespec* duration );
+peachos_nanosleep:
+    ; create stack frame
+    push ebp
+    mov ebp, esp
+    push ebx
+
+    ; body
+    mov eax, 14 ; command 'nanosleep'
+    mov ebx, [ebp+8] ; duration
+    call [peachos_kernel_call]
+
+    ; destroy stack frame
+    pop ebx
+    pop ebp
+    ret
+
+; int peachos_clock_gettime( int clock, struct timespec* out );
+peachos_clock_gettime:
+    ; create stack frame
+    push ebp
+    mov ebp, esp
+    push ebx
+
+    ; body
+    mov eax, 15 ; command 'clock_gettime'
+    mov ebx, [ebp+8] ; clock
+    mov ecx, [ebp+12] ; out
+    call [peachos_kernel_call]
+
+    ; destroy stack frame
+    pop ebx
+    pop ebp
+    ret
+
+; uint64_t peachos_rdtsc(); (rdtsc already returns in edx:eax, like a C function returning a uint64_t)
+peachos_rdtsc:
+    rdtsc
+    ret
+
+; uint64_t peachos_div64( uint64_t dividend, uint32_t divisor, uint32_t* remainder );
+; (2 divs: the high half's remainder becomes the top of the 2nd dividend, so neither can overflow)
+peachos_div64:
+    push ebx
+    mov ecx, [esp+16] ; divisor
+    mov eax, [esp+12] ; dividend (high)
+    xor edx, edx
+    div ecx
+    mov ebx, eax ; quotient (high)
+    mov eax, [esp+8] ; dividend (low)
+    div ecx
+    mov ecx, [esp+20] ; remainder pointer
+    test ecx, ecx
+    jz .done
+    mov [ecx], edx
+.done:
+    mov edx, ebx ; edx:eax = quotient
+    pop ebx
+    ret
@@ -43,12 +43,6 @@ struct command_argument* peachos_parse_command( const char* command, int max ) {
     return root_command;
 }
 
-int peachos_getkey_block() {
-    int val;
-    do val = peachos_getkey(); while( !val );
-    return val;
-}
-
 void peachos_terminal_readline( char* out, int max, bool output_while_typing ) {
     int i;
     for( i = 0; i < max - 1; i++ ) {
@@ -85,3 +79,30 @@ int peachos_system_run( const char* command ) {
     // run it
     return peachos_system( root_arg );
 }
+
+// -- SHARED PAGES --
+
+static volatile struct peachos_shared_page* const shared_page = (void*)PEACHOS_SHARED_PAGE_ADDRESS;
+static volatile struct peachos_process_page* const process_page = (void*)PEACHOS_PROCESS_PAGE_ADDRESS;
+
+// (retry if the timer interrupt updated the count while we were reading it)
+uint64_t peachos_ticks() {
+    uint32_t sequence;
+    uint64_t ticks;
+    do {
+        sequence = shared_page->sequence;
+        ticks = shared_page->ticks;
+    } while( (sequence & 1) || sequence != shared_page->sequence );
+    return ticks;
+}
+
+void peachos_clock_monotonic( struct timespec* out ) {
+    uint32_t frequency = shared_page->clock_frequency, remainder;
+    uint64_t count = shared_page->tsc ? (peachos_rdtsc() - shared_page->tsc_base) >> shared_page->tsc_shift : peachos_ticks();
+    out->tv_sec = (uint32_t)peachos_div64( count, frequency, &remainder );
+    out->tv_nsec = (uint32_t)peachos_div64( (uint64_t)remainder * 1000000000, frequency, NULL );
+}
+
+int peachos_getpid() { return process_page->process_id; }
+
+int peachos_focused_pid() { return shared_page->focused_process_id; }
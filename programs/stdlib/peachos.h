@@ -1,6 +1,24 @@
 #pragma once
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+// time (clock ids match posix, & only CLOCK_MONOTONIC is supported)
+#define CLOCK_MONOTONIC 1
+struct timespec { unsigned int tv_sec, tv_nsec; }; // same layout as the kernel's timer/timer.h
+
+// read-only pages the kernel maps into every process (same layout as the kernel's task/shared.h)
+#define PEACHOS_SHARED_PAGE_ADDRESS 0x1000
+#define PEACHOS_PROCESS_PAGE_ADDRESS 0x2000
+struct peachos_shared_page {
+    uint32_t sequence; // odd while the kernel is updating 'ticks'
+    uint64_t ticks;
+    uint32_t tick_frequency;
+    uint32_t tsc, tsc_shift, clock_frequency; // monotonic clock: (rdtsc - tsc_base) >> tsc_shift ticks @ clock_frequency (or if !tsc, 'ticks' does)
+    uint64_t tsc_base;
+    int32_t focused_process_id;
+};
+struct peachos_process_page { int32_t process_id; };
 
 // process argument
 struct process_arguments { int argc; char** argv; };
@@ -22,3 +40,16 @@ void peachos_process_get_arguments( struct process_arguments* args );
 int peachos_system( struct command_argument* arguments );
 int peachos_system_run( const char* command );
 void peachos_exit();
+int peachos_idle_percent(); // % of the time (since boot) the cpu has spent halted, w/ nothing to run
+int peachos_fork(); // returns 0 in the new (child) process, the child's process id in the parent, or < 0 on error
+void peachos_sleep_ms( unsigned int ms ); // parks the process (w/o using the cpu) for at least 'ms' milliseconds
+int peachos_nanosleep( const struct timespec* duration ); // returns < 0 if the duration is invalid
+int peachos_clock_gettime( int clock, struct timespec* out ); // returns < 0 on error
+
+// read straight from the shared pages (no kernel call)
+uint64_t peachos_ticks(); // timer ticks since boot
+void peachos_clock_monotonic( struct timespec* out ); // same clock as peachos_clock_gettime( CLOCK_MONOTONIC, ... )
+int peachos_getpid();
+int peachos_focused_pid(); // -1 if no process has the focus
+uint64_t peachos_rdtsc();
+uint64_t peachos_div64( uint64_t dividend, uint32_t divisor, uint32_t* remainder ); // (there's no libgcc, so 64 bit division is done in asm) 'remainder' may be NULL
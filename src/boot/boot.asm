@@ -5,6 +5,8 @@ ORG 0x7C00 ; code origin (since this is where bios will load 1st sector (512 byt
 BITS 16 ; 16-bit real mode (segmented memory model)
 CODE_SEG equ gdt_code - gdt_start ; offset to gdt_code (should be 0x08)
 DATA_SEG equ gdt_data - gdt_start ; offset to gdt_data (should be 0x10)
+MEMORY_MAP equ 0x500 ; where we store the BIOS memory map (must match PEACHOS_MEMORY_MAP_ADDRESS in config.h)
+MEMORY_MAP_MAX_ENTRIES equ 64 ; must match PEACHOS_MEMORY_MAP_MAX_ENTRIES in config.h
 
 ; --BPB (BIOS parameter block) --
 ; This describes the physical layout of a data storage volume.
@@ -51,6 +53,7 @@ main16:
     mov ss, ax ; stack segment = 0
     mov sp, 0x7C00 ; stack pointer = 0x7C00 (stack grows down)
     sti ; enable interrupts
+    call detect_memory ; BIOS services are only available in real mode, so grab the memory map now
 load_protected:
     ; enter protected mode (32-bit)
     cli ; disable interrupts
@@ -59,6 +62,30 @@ load_protected:
     or eax, 1
     mov cr0, eax
     jmp CODE_SEG:load32
+
+; collects the BIOS E820 memory map (https://wiki.osdev.org/Detecting_Memory_(x86))
+; layout @ MEMORY_MAP: dword entry count, then 24-byte entries (qword base, qword length, dword type, dword ACPI attributes)
+detect_memory:
+    mov dword [MEMORY_MAP], 0 ; no entries yet (kernel falls back to a default layout if this stays 0)
+    mov di, MEMORY_MAP + 4 ; es:di = where the BIOS writes the next entry
+    xor ebx, ebx ; continuation value (0 = start of the map)
+.next_entry:
+    mov eax, 0xE820
+    mov edx, 0x534D4150 ; 'SMAP' signature
+    mov ecx, 24 ; ask for ACPI 3.0 sized entries
+    mov dword [es:di + 20], 1 ; mark the entry valid, in case the BIOS only fills in 20 bytes
+    int 0x15
+    jc .done ; carry set = unsupported, or we're already past the last entry
+    cmp eax, 0x534D4150 ; BIOS must echo the signature back
+    jne .done
+    inc dword [MEMORY_MAP]
+    add di, 24
+    test ebx, ebx ; ebx = 0 means that was the last entry
+    jz .done
+    cmp dword [MEMORY_MAP], MEMORY_MAP_MAX_ENTRIES
+    jb .next_entry
+.done:
+    ret
     
 ; GDT (global descriptor table)
 gdt_start:
@@ -88,9 +115,10 @@ gdt_descriptor:
 [BITS 32]
 load32:
     mov eax, 1 ; LBA 1 (logical block address 1, which is just past the bootloader)
-    mov ecx, 100 ; 100 sectors (entire kernel)
+    mov ecx, 199 ; 199 sectors (entire kernel, i.e. all the reserved sectors after this one)
     mov edi, 0x100000 ; loads kernel into 1MB position in memory
     call ata_lba_read ; loads kernel into memory
+    mov ebx, MEMORY_MAP ; hand the memory map to the kernel (kernel.asm passes it on to kernel_main)
     jmp CODE_SEG:0x100000 ; jump to kernel '_start'
 
 ata_lba_read:
@@ -3,14 +3,31 @@
 #define KERNEL_CODE_SELECTOR 0x08
 #define KERNEL_DATA_SELECTOR 0x10
 
+// higher half kernel: the top 1 GB of every address space belongs to the kernel (supervisor-only), userland gets the rest
+#define PEACHOS_KERNEL_VIRTUAL_BASE 0xC0000000 // physical RAM is mapped 1:1 from here (kernel image included), so kernel.asm & linker.ld must agree
+#define PEACHOS_USER_SPACE_END PEACHOS_KERNEL_VIRTUAL_BASE
+
 // interrupts
 #define PEACHOS_TOTAL_INTERRUPTS 512
 
+// memory map (collected from the BIOS by boot.asm, https://wiki.osdev.org/Detecting_Memory_(x86))
+#define PEACHOS_MEMORY_MAP_ADDRESS 0x00000500 // start of free conventional memory, well below the boot sector
+#define PEACHOS_MEMORY_MAP_MAX_ENTRIES 64
+#define PEACHOS_MAX_PHYSICAL_ADDRESS 0x3FC00000 // RAM has to fit in the kernel's 1 GB window (less 4 MB, so window pointers never wrap to 0)
+
 // memory
-#define PEACHOS_HEAP_SIZE_BYTES 104857600 // 100 MB
 #define PEACHOS_HEAP_BLOCK_SIZE 4096
-#define PEACHOS_HEAP_ADDRESS 0x01000000 // https://wiki.osdev.org/Memory_Map_(x86)
+#define PEACHOS_HEAP_ADDRESS 0x01000000 // https://wiki.osdev.org/Memory_Map_(x86) (everything below 16 MB is left to the kernel image, stacks & BIOS)
 #define PEACHOS_HEAP_TABLE_ADDRESS 0x00007E00 // ends @ 0x0007FFFF (480 KB usable memory segment)
+#define PEACHOS_HEAP_TABLE_END_ADDRESS 0x00080000 // the block table & free-space index must fit below this (caps the heap @ ~1.7 GB)
+#define PEACHOS_HEAP_RAM_DIVISOR 8 // the heap gets 1/8th of usable RAM, the frame allocator gets the rest
+#define PEACHOS_HEAP_MIN_SIZE_BYTES 4194304 // 4 MB
+
+// physical page frames (buddy allocator)
+#define PEACHOS_FRAME_SIZE 4096
+
+// fallback for when the BIOS gives us no memory map: assume usable RAM from PEACHOS_HEAP_ADDRESS up to here
+#define PEACHOS_DEFAULT_MEMORY_END 0x07400000
 
 // disk
 #define PEACHOS_SECTOR_SIZE 512
@@ -25,15 +42,24 @@
 
 // tasks
 #define PEACHOS_PROGRAM_VIRTUAL_ADDRESS 0x400000
-#define PEACHOS_USER_PROGRAM_STACK_SIZE (1024 * 16) // 16 KB stack
+#define PEACHOS_USER_PROGRAM_STACK_SIZE (1024 * 1024) // 1 MB stack limit (pages are only allocated as the stack grows into them)
 #define PEACHOS_PROGRAM_VIRTUAL_STACK_ADDRESS_START 0x3FF000
 #define PEACHOS_PROGRAM_VIRTUAL_STACK_ADDRESS_END (PEACHOS_PROGRAM_VIRTUAL_STACK_ADDRESS_START - PEACHOS_USER_PROGRAM_STACK_SIZE) // stack grows downwards on intel chips
+#define PEACHOS_TIMER_FREQUENCY 1000 // Hz, i.e. a 1 ms tick
+#define PEACHOS_TASK_QUANTUM_TICKS 10 // a top priority task runs for up to this many ticks before the scheduler switches (doubles per level down)
+#define PEACHOS_TASK_PRIORITY_LEVELS 4 // run queues (at most 32, they're tracked in a bitmap)
+#define PEACHOS_TASK_BOOST_TICKS 1000 // every task goes back to the top priority this often (so nothing starves)
+#define PEACHOS_TASK_KERNEL_STACK_SIZE 16384 // per task (a power of 2, since it comes from the frame allocator)
 #define USER_DATA_SEGMENT 0x23 // GDT offset
 #define USER_CODE_SEGMENT 0x1B // ...
 
 // process
-#define PEACHOS_MAX_PROGRAM_ALLOCATIONS 1024
+#define PEACHOS_PROGRAM_HEAP_VIRTUAL_ADDRESS 0x00800000 // process_malloc hands out addresses from here...
+#define PEACHOS_PROGRAM_HEAP_VIRTUAL_ADDRESS_END PEACHOS_USER_SPACE_END // ...up to the kernel's half
 #define PEACHOS_MAX_PROCESSES 12
+#define PEACHOS_MAX_COMMAND_ARGUMENTS 32 // longest argument list a system command can pass
+#define PEACHOS_SHARED_PAGE_ADDRESS 0x1000 // read-only kernel info (time, focused process), the same frame in every process (page 0 stays unmapped, for NULL)
+#define PEACHOS_PROCESS_PAGE_ADDRESS 0x2000 // read-only info about the process itself (both pages sit below the stack's limit)
 #define PEACH_MAX_ISR80H_COMMANDS 1024 // kernel calls
 
 // keyboard (virtual layer)
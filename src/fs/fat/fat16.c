@@ -5,6 +5,7 @@
 #include "disk/streamer.h"
 #include "memory/memory.h"
 #include "memory/heap/kheap.h"
+#include "memory/heap/slab.h"
 #include "string/string.h"
 #include "kernel.h"
 #include "config.h"
@@ -99,6 +100,7 @@ struct fat_item {
 
     FAT_ITEM_TYPE type;
 };
+static struct slab_cache fat_item_cache = SLAB_CACHE( "fat_item", sizeof( struct fat_item ) );
 
 // represents an open file
 struct fat_file_descriptor {
@@ -430,7 +432,7 @@ out:
 // allocates & initialized as new fat item (our in-memory representation) from a directory item (on-disk representation)
 struct fat_item* fat16_new_fat_item_for_directory_item( struct disk* disk, struct fat_directory_item* item ) {
     // allocate fat_item
-    struct fat_item* f_item = kzalloc( sizeof( struct fat_item ) );
+    struct fat_item* f_item = slab_zalloc( &fat_item_cache );
     if( !f_item ) return NULL;
 
     // check if item is a subdirectory
@@ -5,6 +5,9 @@
 #include "memory/memory.h"
 #include "status.h"
 #include "config.h"
+#include "memory/heap/slab.h"
+
+static struct slab_cache path_part_cache = SLAB_CACHE( "path_part", sizeof( struct path_part ) );
 
 // 0:/folder/file.ext
 static int pathparser_path_valid_format( const char* filename ) {
@@ -60,7 +63,7 @@ struct path_part* pathparser_parse_path_part( struct path_part* last_part, const
     if( !path_part_str ) return NULL;
 
     // create path_part object
-    struct path_part* part = kzalloc( sizeof( struct path_part ) );
+    struct path_part* part = slab_zalloc( &path_part_cache );
     part->part = path_part_str;
     part->next = NULL;
 
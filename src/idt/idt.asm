@@ -5,14 +5,19 @@ section .asm
 extern int21h_handler
 extern no_interrupt_handler
 extern isr80h_handler
+extern sysenter_handler
 extern interrupt_handler
+extern tss
 
 ; exports
 global enable_interrupts
 global disable_interrupts
+global idle_halt
+global halt_forever
 global idt_load
 global no_interrupt
 global isr80h_wrapper
+global sysenter_wrapper
 global interrupt_pointer_table
 
 enable_interrupts:
@@ -23,6 +28,19 @@ disable_interrupts:
     cli
     ret
 
+; void idle_halt(); sleeps until the next interrupt
+; (sti only takes effect after the next instruction, so no interrupt can slip in between it & the hlt, & get missed)
+idle_halt:
+    sti
+    hlt
+    ret
+
+; void halt_forever(); stops the cpu for good (w/o burning cycles)
+halt_forever:
+    cli
+    hlt
+    jmp halt_forever
+
 idt_load:
     ; C function entry
     push ebp
@@ -47,6 +65,10 @@ no_interrupt:
     global int%1 ; export this as int0, int1, int2, ...
     int%1: ; here is the label
         ; interrupt frame start
+        ; the cpu pushes an error code for exceptions 8, 10-14, 17 & 21, so push a dummy one for everything else (keeps the frame the same shape)
+        %if !(%1 == 8 || (%1 >= 10 && %1 <= 14) || %1 == 17 || %1 == 21)
+            push dword 0
+        %endif
         pushad ; push general purpose registers (ip, cs, falgs, sp, ss already pushed by cpu before calling interrupt)
         ; interrupt frame end
 
@@ -56,8 +78,9 @@ no_interrupt:
         call interrupt_handler
         add esp, 8 ; pop arguments
 
-        ; pop general purpose registers & return
+        ; pop general purpose registers & error code, then return
         popad
+        add esp, 4
         iret
 %endmacro
 
@@ -70,27 +93,57 @@ no_interrupt:
 
 isr80h_wrapper:
     ; interrupt frame start
+    push dword 0 ; no error code (keeps the frame the same shape as the other interrupts)
     pushad ; push all general purpose registers (uint32_t ip, cs, flags, sp, ss already pushed by processor before entering this handler)
     ; interrupt frame end
 
-    ; call isr80h_handler
+    ; call isr80h_handler (which leaves the result in the frame's eax slot, so nothing is kept outside this stack)
     push esp ; push arg: stack pointer (points to interrupt frame)
     push eax ; push arg: contains the command that our kernel will invoke
     call isr80h_handler ; call handler
-    mov dword[return_code], eax ; stash return code (which is in eax)
     add esp, 8 ; pop arguments
 
-    ; restore general purpose regs from interrupt frame start
+    ; restore general purpose regs (& the result) from interrupt frame start
     popad
-    mov eax, [return_code]
+    add esp, 4 ; pop error code
     iretd
 
+; fast kernel call: the caller's stub does 'push <return address>', 'mov ebp, esp' & 'sysenter'
+; the cpu only switches cs, eip, ss & esp, so build the frame an 'int 0x80' would've pushed, then leave w/ sysexit
+sysenter_wrapper:
+    ; SYSENTER_ESP is left at 0: the current task's kernel stack is in the TSS instead (interrupts are off until sti)
+    mov esp, [tss+4] ; tss.esp0
+
+    ; interrupt frame start
+    push dword 0x23 ; ss (user data segment)
+    push ebp ; esp (sysenter_handler pops the return address off it)
+    pushfd
+    or dword[esp], 0x200 ; flags (sysenter cleared IF, but userland always runs w/ it set)
+    push dword 0x1B ; cs (user code segment)
+    push dword 0 ; ip (sysenter_handler reads it off the user stack)
+    push dword 0 ; no error code
+    pushad
+    ; interrupt frame end
+
+    ; call sysenter_handler (result goes in the frame's eax slot)
+    push esp ; push arg: stack pointer (points to interrupt frame)
+    call sysenter_handler
+    add esp, 4 ; pop argument
+
+    ; restore general purpose regs (& the result) from interrupt frame start
+    popad
+    add esp, 4 ; pop error code
+
+    ; sysexit resumes userland @ edx w/ esp = ecx (both are scratch registers in the stub, so they aren't restored)
+    mov edx, [esp] ; ip
+    mov ecx, [esp+12] ; esp
+    add esp, 20 ; pop ip, cs, flags, esp & ss
+    sti ; (only takes effect after the next instruction, so no interrupt can land on the kernel stack in between)
+    sysexit
+
 ; data section
 section .data
 
-; temporary space to hold return code for isr80h_handler
-return_code: dd 0
-
 ; interrupt pointer table entry
 %macro interrupt_array_entry 1
     dd int%1 ; label for int* function that we defined earlier
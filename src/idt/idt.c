@@ -6,6 +6,10 @@
 #include "task/process.h"
 #include "io/io.h"
 #include "status.h"
+#include "memory/paging/paging.h"
+#include "task/tss.h"
+#include "timer/timer.h"
+#include "task/shared.h"
 
 // interrupt descriptor table
 struct idt_desc idt_descriptors[PEACHOS_TOTAL_INTERRUPTS];
@@ -25,6 +29,7 @@ extern void idt_load( struct idtr_desc* p );
 extern void int21h();
 extern void no_interrupt();
 extern void isr80h_wrapper();
+extern void sysenter_wrapper();
 
 void idt_set( int i, void* func ) {
     struct idt_desc* desc = &idt_descriptors[i];
@@ -40,14 +45,16 @@ void interrupt_handler( int interrupt, struct interrupt_frame* frame ) {
     kernel_page();
 
     // lookup callback function
+    // (only interrupts from userland carry the task's state, kernel ones don't even have esp & ss)
     INTERRUPT_CALLBACK_FUNCTION callback = interrupt_callbacks[interrupt];
     if( callback ) {
-        task_current_save_state( frame );
+        if( frame->cs & 3 ) task_current_save_state( frame );
         callback( frame );
     }
 
-    // switch back to userland page
-    task_page();
+    // switch back to userland's segments & page directory, but only if that's where we're returning to
+    // (the idle task & interrupted kernel code run on the kernel's segments)
+    if( frame->cs & 3 ) task_page();
 
     // send acknowledgement that interrupt was handled
     outb( 0x20, 0x20 );
@@ -63,10 +70,6 @@ void no_interrupt_handler() {
     outb( 0x20, 0x20 );
 }
 
-void page_fault() {
-    panic( "page fault\n" );
-}
-
 void idt_handle_exception() {
     // terminate the currently executing process
     process_terminate( task_current()->process );
@@ -75,12 +78,24 @@ void idt_handle_exception() {
     task_next();
 }
 
+// pages of a process are allocated on first touch, so most page faults just need the page filled in
+void idt_page_fault( struct interrupt_frame* frame ) {
+    struct task* task = task_current();
+    if( task && task->process && vm_handle_fault( &task->process->vm, paging_fault_address(), frame->error_code ) >= 0 ) return;
+
+    // a bad access from the kernel is a bug, a bad access from userland kills the process
+    if( !(frame->cs & 3) ) panic( "page fault in kernel\n" );
+    idt_handle_exception();
+}
+
 void idt_clock() {
     // acknowledge interrupts
     outb( 0x20, 0x20 );
 
-    // continue by running next task
-    task_next();
+    // count the tick, & switch tasks if the current one has used up its quantum
+    timer_tick();
+    shared_page_tick();
+    task_tick();
 }
 
 void idt_init() {
@@ -96,16 +111,16 @@ void idt_init() {
     // set interrupt 0 (divide by zero exception)
     //idt_set( 0, idt_zero );
 
-    // set interrupt 14 (page fault)
-    //idt_set( 14, page_fault );
-
     // kernel call from userland
     idt_set( 0x80, isr80h_wrapper );
 
     // userland exeptions should crash the process
     for( int i = 0; i < 0x20; i++ ) idt_register_interrupt_callback( i, idt_handle_exception );
 
-    // every clock tick, change the current task
+    // ...except page faults, which are mostly just pages that haven't been allocated yet
+    idt_register_interrupt_callback( 14, idt_page_fault );
+
+    // every clock tick, charge the current task's quantum
     idt_register_interrupt_callback( 0x20, idt_clock );
 
     // load the interrupt descriptor table
@@ -144,17 +159,41 @@ void* isr80h_handle_command( int command, struct interrupt_frame* frame ) {
     return function( frame );
 }
 
-void* isr80h_handler( int command, struct interrupt_frame* frame ) {
+// the result goes straight into the frame's eax (which the wrapper pops back into userland), so the path is reentrant
+void isr80h_handler( int command, struct interrupt_frame* frame ) {
     // switch to the kernel page
     kernel_page();
 
     // copy interrupt_frame's registers into task (this allows us to switch tasks if we wanted to)
     task_current_save_state( frame );
 
-    // get the command
-    void* res = isr80h_handle_command( command, frame );
+    // run the command
+    frame->eax = (uint32_t)isr80h_handle_command( command, frame );
 
     // switch back to task page
     task_page();
-    return res;
+}
+
+// sysenter doesn't save where userland left off, so the stub leaves the return address on top of its stack (in ebp)
+void sysenter_handler( struct interrupt_frame* frame ) {
+    frame->esp = frame->ebp + sizeof( uint32_t );
+    if( copy_from_user( task_current(), &frame->ip, (void*)frame->ebp, sizeof( frame->ip ) ) < 0 ) {
+        // nowhere to return to
+        kernel_page();
+        process_terminate( task_current()->process );
+        task_next();
+    }
+    isr80h_handler( frame->eax, frame );
+}
+
+// points the SYSENTER MSRs @ sysenter_wrapper (a no-op if the cpu doesn't have it, userland then sticks to int 0x80)
+bool idt_sysenter_init() {
+    if( !tss_has_sysenter() ) return false;
+    tss_write_msr( TSS_MSR_SYSENTER_CS, KERNEL_CODE_SELECTOR );
+
+    // every task has its own kernel stack, so rather than rewriting this MSR on each task switch,
+    // sysenter_wrapper's 1st instruction loads esp from tss.esp0 (which task_switch keeps current): the MSR's esp is never used
+    tss_write_msr( TSS_MSR_SYSENTER_ESP, 0 );
+    tss_write_msr( TSS_MSR_SYSENTER_EIP, (uint32_t)sysenter_wrapper );
+    return true;
 }
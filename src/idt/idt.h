@@ -1,6 +1,7 @@
 // https://www.udemy.com/course/developing-a-multithreaded-kernel-from-scratch/learn/lecture/23972666
 #pragma once
 #include <stdint.h>
+#include <stdbool.h>
 
 // function signature for 0x80 interrupt (kernel call from userland)
 struct interrupt_frame;
@@ -35,20 +36,24 @@ struct interrupt_frame {
     uint32_t edx;
     uint32_t ecx;
     uint32_t eax;
+    uint32_t error_code; // pushed by the cpu for some exceptions (0 otherwise)
     uint32_t ip;
     uint32_t cs;
     uint32_t flags;
-    uint32_t esp;
+    uint32_t esp; // esp & ss are only pushed when the interrupt came from userland
     uint32_t ss;
 } __attribute__((packed));
 
 // initialize the interrupt descriptor table
 void idt_init();
+bool idt_sysenter_init(); // fast kernel calls (returns false if the cpu has no SYSENTER)
 int idt_register_interrupt_callback( int interrupt, INTERRUPT_CALLBACK_FUNCTION callback );
 
 // enable/disable interrupts
 void enable_interrupts();
 void disable_interrupts();
+void idle_halt();
+void halt_forever();
 
 // register kernel commands that can be called from userspace
 void isr80h_register_command( int command, ISR80H_COMMAND function );
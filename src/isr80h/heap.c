@@ -1,14 +1,15 @@
 #include "heap.h"
 #include "task/task.h"
+#include "isr80h.h"
 #include "task/process.h"
 
 void* isr80h_command4_malloc( struct interrupt_frame* frame ) {
-    size_t size = (size_t)task_get_stack_item( task_current(), 0 );
+    size_t size = (size_t)isr80h_argument( frame, 0 );
     return process_malloc( task_current()->process, size );
 }
 
 void* isr80h_command5_free( struct interrupt_frame* frame ) {
-    void* ptr_to_free = task_get_stack_item( task_current(), 0 );
+    void* ptr_to_free = isr80h_argument( frame, 0 );
     process_free( task_current()->process, ptr_to_free );
     return 0;
 }
@@ -1,25 +1,35 @@
 #include "io.h"
 #include "task/task.h"
+#include "isr80h.h"
 #include "keyboard/keyboard.h"
 #include "kernel.h"
 
 void* isr80h_command1_print( struct interrupt_frame* frame ) {
     // get 1st argument
-    void* user_space_message_buffer = task_get_stack_item( task_current(), 0 );
+    void* user_space_message_buffer = isr80h_argument( frame, 0 );
 
     // read buffer from userspace & copy into kernel space
     char buf[1024];
-    copy_string_from_task( task_current(), user_space_message_buffer, buf, sizeof( buf ) );
+    int res = strncpy_from_user( task_current(), buf, user_space_message_buffer, sizeof( buf ) );
+    if( res < 0 ) return ERROR( res );
 
     // print the buffer
     print( buf );
     return 0;
 }
 
-void* isr80h_command2_getkey( struct interrupt_frame* frame ) { return (void*)(int)keyboard_pop(); }
+// userland polls for keys, so an empty buffer means the task is waiting on the keyboard: let something else run meanwhile
+void* isr80h_command2_getkey( struct interrupt_frame* frame ) {
+    char c = keyboard_pop();
+    if( !c ) task_yield();
+    return (void*)(int)c;
+}
 
 void* isr80h_command3_putchar( struct interrupt_frame* frame ) {
-    char c = (char)(int)task_get_stack_item( task_current(), 0 );
+    char c = (char)(int)isr80h_argument( frame, 0 );
     terminal_writechar( c, 15 );
     return 0;
 }
+
+// sleeps until a key arrives (no cpu is used while waiting)
+void* isr80h_command12_getkey_block( struct interrupt_frame* frame ) { return (void*)(int)keyboard_pop_wait(); }
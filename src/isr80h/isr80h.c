@@ -1,9 +1,11 @@
 #include "isr80h.h"
+#include <stddef.h>
 #include "idt/idt.h"
 #include "misc.h"
 #include "io.h"
 #include "heap.h"
 #include "process.h"
+#include "time.h"
 
 void isr80h_register_commands() {
     isr80h_register_command( SYSTEM_COMMAND0_SUM, isr80h_command0_sum );
@@ -16,4 +18,21 @@ void isr80h_register_commands() {
     isr80h_register_command( SYSTEM_COMMAND7_INVOKE_SYSTEM_COMMAND, isr80h_command7_invoke_system_command );
     isr80h_register_command( SYSTEM_COMMAND8_GET_PROGRAM_ARGUMENTS, isr80h_command8_get_program_arguments );
     isr80h_register_command( SYSTEM_COMMAND9_EXIT, isr80h_command9_exit );
+    isr80h_register_command( SYSTEM_COMMAND10_FORK, isr80h_command10_fork );
+    isr80h_register_command( SYSTEM_COMMAND11_IDLE_PERCENT, isr80h_command11_idle_percent );
+    isr80h_register_command( SYSTEM_COMMAND12_GETKEY_BLOCK, isr80h_command12_getkey_block );
+    isr80h_register_command( SYSTEM_COMMAND13_SLEEP_MS, isr80h_command13_sleep_ms );
+    isr80h_register_command( SYSTEM_COMMAND14_NANOSLEEP, isr80h_command14_nanosleep );
+    isr80h_register_command( SYSTEM_COMMAND15_CLOCK_GETTIME, isr80h_command15_clock_gettime );
+}
+
+void* isr80h_argument( struct interrupt_frame* frame, int index ) {
+    switch( index ) {
+        case 0: return (void*)frame->ebx;
+        case 1: return (void*)frame->ecx;
+        case 2: return (void*)frame->edx;
+        case 3: return (void*)frame->esi;
+        case 4: return (void*)frame->edi;
+        default: return NULL;
+    }
 }
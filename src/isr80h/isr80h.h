@@ -12,6 +12,19 @@ enum SystemCommand {
     SYSTEM_COMMAND7_INVOKE_SYSTEM_COMMAND,
     SYSTEM_COMMAND8_GET_PROGRAM_ARGUMENTS,
     SYSTEM_COMMAND9_EXIT,
+    SYSTEM_COMMAND10_FORK,
+    SYSTEM_COMMAND11_IDLE_PERCENT,
+    SYSTEM_COMMAND12_GETKEY_BLOCK,
+    SYSTEM_COMMAND13_SLEEP_MS,
+    SYSTEM_COMMAND14_NANOSLEEP,
+    SYSTEM_COMMAND15_CLOCK_GETTIME,
 };
 
+// kernel call ABI: eax = command, arguments in ebx, ecx, edx, esi, edi (in that order), result in eax
+// (so decoding arguments never touches user memory; only the legacy SUM command still reads its arguments off the user stack)
+#define ISR80H_MAX_ARGUMENTS 5
+
+struct interrupt_frame;
+
 void isr80h_register_commands();
+void* isr80h_argument( struct interrupt_frame* frame, int index );
@@ -2,9 +2,12 @@
 #include "task/task.h"
 #include <stddef.h>
 
-// TODO: this is very inefficient way to get stack items, we ideally should do them all in one swoop
+// legacy command: its arguments are on the user stack, rather than in registers
 void* isr80h_command0_sum( struct interrupt_frame* frame ) {
     int arg1 = (int)task_get_stack_item( task_current(), 1 ),
         arg0 = (int)task_get_stack_item( task_current(), 0 );
     return (void*)(arg0 + arg1);
 }
+
+// how much of the time the cpu has been halted (so the host's cpu use can be tracked)
+void* isr80h_command11_idle_percent( struct interrupt_frame* frame ) { return (void*)task_idle_percent(); }
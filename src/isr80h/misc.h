@@ -2,3 +2,4 @@
 
 struct interrupt_frame;
 void* isr80h_command0_sum( struct interrupt_frame* frame );
+void* isr80h_command11_idle_percent( struct interrupt_frame* frame );
@@ -1,18 +1,20 @@
 #include "process.h"
 #include "task/task.h"
+#include "isr80h.h"
 #include "task/process.h"
 #include "status.h"
 #include "config.h"
 #include "string/string.h"
 #include "kernel.h"
+#include "memory/heap/kheap.h"
 
 void* isr80h_command6_process_load_start( struct interrupt_frame* frame ) {
     // get filename pointer in userspace
-    void* userspace_filename = task_get_stack_item( task_current(), 0 );
+    void* userspace_filename = isr80h_argument( frame, 0 );
 
     // copy userspace filename into kernelspace filename
     char filename[PEACHOS_MAX_PATH];
-    int res = copy_string_from_task( task_current(), userspace_filename, filename, sizeof( filename ) );
+    int res = strncpy_from_user( task_current(), filename, userspace_filename, sizeof( filename ) );
     if( res < 0 ) return ERROR( res );
 
     // flesh it out into a full path
@@ -24,17 +26,44 @@ void* isr80h_command6_process_load_start( struct interrupt_frame* frame ) {
     struct process* process = NULL;
     if( (res = process_load_focus( path, &process )) < 0 ) return ERROR( res );
 
-    // switch to the new task
-    task_switch( process->task );
-    task_return( &process->task->registers );
+    // switch to the new task (we carry on from here when the scheduler comes back to us)
+    task_run( process->task );
     return NULL;
 }
 
+static void isr80h_free_command_arguments( struct command_argument* arg ) {
+    for( struct command_argument* next; arg; arg = next ) { next = arg->next; kfree( arg ); }
+}
+
+// copies the caller's linked list of arguments into the kernel (each node is checked as it's read)
+static int isr80h_copy_command_arguments( struct task* task, struct command_argument* user_arg, struct command_argument** root_out ) {
+    struct command_argument* root = NULL, **link = &root;
+    int res = 0;
+    for( int i = 0; user_arg; i++ ) {
+        if( i >= PEACHOS_MAX_COMMAND_ARGUMENTS ) { res = -EINVARG; goto out; }
+        struct command_argument* arg = kmalloc( sizeof( struct command_argument ) );
+        if( !arg ) { res = -ENOMEM; goto out; }
+        if( (res = copy_from_user( task, arg, user_arg, sizeof( struct command_argument ) )) < 0 ) { kfree( arg ); goto out; }
+        arg->argument[sizeof( arg->argument ) - 1] = 0;
+        user_arg = arg->next;
+        arg->next = NULL;
+        *link = arg;
+        link = &arg->next;
+    }
+    *root_out = root;
+
+out:
+    if( res < 0 ) isr80h_free_command_arguments( root );
+    return res;
+}
+
 void* isr80h_command7_invoke_system_command( struct interrupt_frame* frame ) {
     // get 1st arg
     struct task *task = task_current();
-    struct command_argument *root_arg = task_virtual_address_to_physical( task, task_get_stack_item( task, 0 ) );
-    if( !root_arg || 0 == strlen( root_arg[0].argument ) ) return ERROR( -EINVARG );
+    struct command_argument *root_arg = NULL;
+    int res = isr80h_copy_command_arguments( task, isr80h_argument( frame, 0 ), &root_arg );
+    if( res < 0 ) return ERROR( res );
+    if( !root_arg || 0 == strlen( root_arg->argument ) ) { res = -EINVARG; goto out; }
 
     // turn 1st arg into a full path
     // TODO: the lecture does sizeof( path ) instead of sizeof( path ) - 3
@@ -45,29 +74,29 @@ void* isr80h_command7_invoke_system_command( struct interrupt_frame* frame ) {
 
     // load process & give it focus
     struct process* process = NULL;
-    int res = process_load( path, &process );
-    if( res < 0 ) return ERROR( res );
+    if( (res = process_load( path, &process )) < 0 ) goto out;
 
     // inject our command arguments
-    if( (res = process_inject_arguments( process, root_arg )) < 0 ) return ERROR( res );
+    res = process_inject_arguments( process, root_arg );
 
-    // switch current-task and switch to user page directory
-    task_switch( process->task );
+out:
+    isr80h_free_command_arguments( root_arg );
+    if( res < 0 ) return ERROR( res );
 
-    // drop into the task TODO: still not how we access the registers *after* we switch the paging directory (unless, of course, these regs are in the user's address space!)
-    task_return( &process->task->registers );
+    // switch to the new task (we carry on from here when the scheduler comes back to us)
+    task_run( process->task );
     return NULL;
 }
 
 void* isr80h_command8_get_program_arguments( struct interrupt_frame* frame ) {
     // get 1st arg
     struct task* task = task_current();
-    void* item = task_get_stack_item( task, 0 );
+    void* item = isr80h_argument( frame, 0 );
 
-    // convert pointer to kernel space & write the process' arguments into it
-    struct process_arguments* args = task_virtual_address_to_physical( task, item );
-    process_get_arguments( task->process, &args->argc, &args->argv );
-    return 0;
+    // write the process' arguments into it
+    struct process_arguments args;
+    process_get_arguments( task->process, &args.argc, &args.argv );
+    return ERROR( copy_to_user( task, item, &args, sizeof( args ) ) );
 }
 
 void* isr80h_command9_exit( struct interrupt_frame* frame ) {
@@ -75,3 +104,11 @@ void* isr80h_command9_exit( struct interrupt_frame* frame ) {
     task_next();
     return 0;
 }
+
+// returns 0 in the child, & the child's process id in the parent
+void* isr80h_command10_fork( struct interrupt_frame* frame ) {
+    struct process* child = NULL;
+    int res = process_fork( task_current()->process, &child );
+    if( res < 0 ) return ERROR( res );
+    return (void*)(int)child->id;
+}
@@ -0,0 +1,28 @@
+#include "time.h"
+#include "isr80h.h"
+#include "task/task.h"
+#include "timer/timer.h"
+#include "timer/clock.h"
+#include "kernel.h"
+
+// parks the calling task until at least 'ms' milliseconds have passed
+void* isr80h_command13_sleep_ms( struct interrupt_frame* frame ) {
+    timer_sleep_ms( (uint32_t)isr80h_argument( frame, 0 ) );
+    return 0;
+}
+
+// parks the calling task for the (user) timespec's duration, rounded up to whole ticks
+void* isr80h_command14_nanosleep( struct interrupt_frame* frame ) {
+    struct timespec duration;
+    int res = copy_from_user( task_current(), &duration, isr80h_argument( frame, 0 ), sizeof( duration ) );
+    if( res < 0 ) return ERROR( res );
+    return ERROR( timer_nanosleep( &duration ) );
+}
+
+// writes the clock's time to a (user) timespec
+void* isr80h_command15_clock_gettime( struct interrupt_frame* frame ) {
+    struct timespec now;
+    int res = clock_gettime( (int)isr80h_argument( frame, 0 ), &now );
+    if( res < 0 ) return ERROR( res );
+    return ERROR( copy_to_user( task_current(), isr80h_argument( frame, 1 ), &now, sizeof( now ) ) );
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+struct interrupt_frame;
+void* isr80h_command13_sleep_ms( struct interrupt_frame* frame );
+void* isr80h_command14_nanosleep( struct interrupt_frame* frame );
+void* isr80h_command15_clock_gettime( struct interrupt_frame* frame );
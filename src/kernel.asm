@@ -11,6 +11,12 @@ global kernel_registers
 ; defines
 CODE_SEG equ 0x08
 DATA_SEG equ 0x10
+KERNEL_VIRTUAL_BASE equ 0xC0000000 ; must match PEACHOS_KERNEL_VIRTUAL_BASE (config.h) & linker.ld
+KERNEL_PDE_INDEX equ KERNEL_VIRTUAL_BASE >> 22 ; 1st page directory slot of the higher half
+KERNEL_STACK equ 0x00200000 ; physical
+
+; the entry point & boot page directory run before paging is on, so linker.ld places them @ their physical address
+section .boot progbits alloc exec write align=4096
 
 ; protected mode
 _start:
@@ -21,8 +27,6 @@ _start:
     mov fs, ax
     mov gs, ax
     mov ss, ax
-    mov ebp, 0x00200000
-    mov esp, ebp
 
     ; enable the A20 line for physical memory
     ; (disabled for historical 8086 has a quirk called "memory wraparound" that some programs relied on, so the 20th bit was latched to zero).
@@ -43,15 +47,94 @@ _start:
     mov al, 00000001b ; b4=0: FNM, b3-2=00: master/slave set by hardware; b1=0: not AEOI; b0=1: x86 mode
     out 0x21, al ; 0x21 = more data
 
-    ; enter C function 'kernel_main'
+    ; the boot directory (& the kernel's window onto RAM) use 4 MB pages, so the cpu must have PSE (cpuid leaf 1: edx bit 3)
+    ; (cpuid itself only exists if EFLAGS.ID can be toggled, & it clobbers ebx, which holds the memory map)
+    mov esp, KERNEL_STACK
+    pushfd
+    pop eax
+    mov ecx, eax
+    xor eax, 0x200000
+    push eax
+    popfd
+    pushfd
+    pop eax
+    push ecx
+    popfd
+    xor eax, ecx
+    jz .no_pse
+    push ebx
+    mov eax, 1
+    cpuid
+    pop ebx
+    bt edx, 3
+    jnc .no_pse
+
+    ; turn on paging w/ the boot directory (4 MB pages need CR4.PSE)
+    mov eax, cr4
+    or eax, 0x10
+    mov cr4, eax
+    mov eax, boot_page_directory
+    mov cr3, eax
+    mov eax, cr0
+    or eax, 0x80000000
+    mov cr0, eax
+
+    ; jump up into the higher half (an absolute jump, since we're still running from the low identity map)
+    mov eax, higher_half
+    jmp eax
+
+    ; no PSE: there's no kernel to panic w/ yet, so write straight to VGA memory (paging is still off) & stop
+.no_pse:
+    cld
+    mov esi, no_pse_message
+    mov edi, 0xB8000
+.print:
+    lodsb
+    test al, al
+    jz .halt
+    mov ah, 0x4F ; white on red
+    stosw
+    jmp .print
+.halt:
+    cli
+    hlt
+    jmp .halt
+
+no_pse_message: db "PeachOS needs a CPU with PSE (4 MB pages)", 0
+
+; maps the 1st 4 MB twice: 1:1 so the code above keeps running once paging is on, & @ KERNEL_VIRTUAL_BASE (along w/ the rest of the 1st GB)
+; the C code replaces it w/ a directory sized to the machine's RAM (see paging_kernel_4gb)
+align 4096
+boot_page_directory:
+    dd 0x00000083 ; 0-4 MB: present, writeable, 4 MB page
+    times (KERNEL_PDE_INDEX - 1) dd 0
+    %assign i 0
+    %rep 1024 - KERNEL_PDE_INDEX
+        dd (i << 22) | 0x83
+        %assign i i + 1
+    %endrep
+
+; the rest of the kernel is linked into the higher half
+section .text
+
+higher_half:
+    ; kernel stack
+    mov ebp, KERNEL_STACK + KERNEL_VIRTUAL_BASE
+    mov esp, ebp
+
+    ; enter C function 'kernel_main' (boot.asm hands us the BIOS memory map in ebx)
+    push ebx
     call kernel_main
 
     ; divide by zero (to test our custom interrupt)
     ;mov eax, 0
     ;div eax
 
-    ; infinite loop
-    jmp $
+    ; stop (kernel_main never returns, but don't spin if it does)
+.halt:
+    cli
+    hlt
+    jmp .halt
 
 ; change segment registers to point to the kernel data segment
 kernel_registers:
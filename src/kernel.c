@@ -5,6 +5,9 @@
 #include "io/io.h"
 #include "memory/memory.h"
 #include "memory/heap/kheap.h"
+#include "memory/heap/slab.h"
+#include "memory/frame/frame.h"
+#include "memory/e820/e820.h"
 #include "memory/paging/paging.h"
 #include "disk/disk.h"
 #include "string/string.h"
@@ -21,6 +24,9 @@
 #include "status.h"
 #include "isr80h/isr80h.h"
 #include "keyboard/keyboard.h"
+#include "timer/timer.h"
+#include "timer/clock.h"
+#include "task/shared.h"
 
 uint16_t* video_mem = 0, terminal_row = 0, terminal_col = 0;
 
@@ -58,8 +64,28 @@ void print( const char* str ) {
     for( int i = 0; i < len; i++ ) terminal_writechar( str[i], 15 );
 }
 
+void print_number( uint32_t n ) {
+    char digits[11]; // (enough for 2^32 - 1, plus the terminator)
+    int i = sizeof( digits ) - 1;
+    digits[i] = 0;
+    do { digits[--i] = '0' + n % 10; n/= 10; } while( n );
+    print( &digits[i] );
+}
+
+// one line per slab cache: objects in use / objects the cache's slabs hold, & the heap memory they take up
+static void kernel_print_slab_stats() {
+    struct slab_stats stats[16];
+    int count = slab_get_stats( stats, sizeof( stats ) / sizeof( stats[0] ) );
+    for( int i = 0; i < count; i++ ) {
+        print( "slab " ); print( stats[i].name ); print( ": " );
+        print_number( stats[i].used_objects ); print( "/" ); print_number( stats[i].total_objects );
+        print( " objects, " ); print_number( stats[i].slabs ); print( " slabs, " );
+        print_number( stats[i].bytes ); print( " bytes\n" );
+    }
+}
+
 void terminal_initialize() {
-    video_mem = (uint16_t*)0xB8000;
+    video_mem = PHYS_TO_VIRT( 0xB8000 );
     for( int y = 0; y < VGA_HEIGHT; y++ )
         for( int x = 0; x < VGA_WIDTH; x++ )
             terminal_putchar( x, y, ' ', 0 );
@@ -69,12 +95,10 @@ extern void problem();
 
 static struct paging_4gb_chunk* kernel_chunk = 0; 
 
-void kernel_page() {
-    kernel_registers();
-    paging_switch( kernel_chunk );
-}
+// note: the kernel is mapped into every address space, so there's no need to switch page directories
+void kernel_page() { kernel_registers(); }
 
-void panic( const char* msg ) { print( msg ); while( 1 ); }
+void panic( const char* msg ) { print( msg ); halt_forever(); }
 
 struct tss tss;
 struct gdt gdt_real[PEACHOS_TOTAL_GDT_SEGMENTS];
@@ -89,7 +113,7 @@ struct gdt_structured gdt_structured[PEACHOS_TOTAL_GDT_SEGMENTS] = {
 
 void pic_timer_callback() { print( "tick\n" ); }
 
-void kernel_main() {
+void kernel_main( struct e820_map* memory_map ) {
     // initialize terminal
     terminal_initialize();
     print( "initialized terminal\n" );
@@ -100,10 +124,19 @@ void kernel_main() {
     gdt_load( gdt_real, sizeof( gdt_real ) );
     print( "loaded the GDT\n" );
 
+    // find out how much physical memory we have (this sizes the heap & frame allocator)
+    // (boot.asm hands us its physical address)
+    if( e820_init( memory_map ? PHYS_TO_VIRT( memory_map ) : NULL ) ) print( "detected physical memory from BIOS E820 map\n" );
+    else print( "no BIOS memory map, assuming default physical memory layout\n" );
+
     // initialize the kernel heap
     kheap_init();
     print( "initialized kernel heap\n" );
 
+    // initialize the physical frame allocator
+    frame_init();
+    print( "initialized frame allocator\n" );
+
     // initialize filesystems
     fs_init();
     print( "initialized filesystems\n" );
@@ -123,13 +156,17 @@ void kernel_main() {
 
     // setup the TSS (task state segment)
     memset( &tss, 0, sizeof( tss ) );
-    tss.esp0 = 0x600000;
+    tss.esp0 = (uint32_t)PHYS_TO_VIRT( 0x600000 );
     tss.ss0 = KERNEL_DATA_SELECTOR;
     tss_load( 0x28 );
     print( "loaded the TSS (task state segment)\n" );
 
-    // enable paging
-    kernel_chunk = paging_new_4gb( PAGING_IS_WRITEABLE | PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL );
+    // fast kernel calls (like interrupts, they switch to the current task's kernel stack from tss.esp0)
+    if( idt_sysenter_init() ) print( "enabled SYSENTER kernel calls\n" );
+
+    // move off kernel.asm's boot page directory & onto the real one (which drops the low identity map)
+    kernel_chunk = paging_kernel_4gb();
+    if( !kernel_chunk ) panic( "failed to create the kernel's page tables\n" );
     paging_switch( kernel_chunk );
     enable_paging();
     print( "initialized page tables & enabled paging\n" );
@@ -142,6 +179,13 @@ void kernel_main() {
     keyboard_init();
     print( "initialized keyboards\n" );
 
+    // the timer drives the scheduler
+    timer_init( PEACHOS_TIMER_FREQUENCY );
+    print( "programmed the PIT (programmable interval timer)\n" );
+    clock_init();
+    print( "calibrated the monotonic clock\n" );
+    if( shared_page_init() < 0 ) panic( "failed to allocate the shared page\n" );
+
     // test: register some interrupt callbacks
     // note: disabled for now: idt_register_interrupt_callback( 0x20, pic_timer_callback ); // timer interrupt
 
@@ -154,6 +198,9 @@ void kernel_main() {
     // (note: we cannot pop, because there's no task to pop yet)
     // keyboard_push( 'A' );
 
+    // report slab occupancy now that the caches the kernel needs to boot are populated
+    kernel_print_slab_stats();
+
     // run first task
     task_run_first_ever_task();
 
@@ -1,4 +1,5 @@
 #pragma once
+#include <stdint.h>
 
 #define VGA_WIDTH 80
 #define VGA_HEIGHT 20
@@ -6,9 +7,11 @@
 #define ERROR_I(value) (int)(value)
 #define ISERR(value) ((int)(value) < 0)
 
-void kernel_main();
-void kernel_page(); // switch to kernel segment and page directory
+struct e820_map;
+void kernel_main( struct e820_map* memory_map );
+void kernel_page(); // switch to kernel segments (kernel pages are mapped into every page directory)
 void kernel_registers();
 void print( const char* str );
+void print_number( uint32_t n );
 void panic( const char* msg );
 void terminal_writechar( char c, char color );
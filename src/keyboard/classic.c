@@ -62,10 +62,8 @@ uint8_t classic_keyboard_scancode_to_char( uint8_t scancode ) {
     return c;
 }
 
+// (runs as an interrupt_handler callback, which takes care of switching segments)
 void classic_keyboard_handle_interrupt() {
-    // switch to kernel page
-    kernel_page();
-    
     // read from keyboard port
     uint8_t scancode = insb( KEYBOARD_INPUT_PORT );
 
@@ -87,9 +85,6 @@ void classic_keyboard_handle_interrupt() {
 
     // push character into the current process' keyboard buffer
     keyboard_push( c );
-
-    // switch back to the task's page
-    task_page();
 }
 
 struct keyboard* classic_init() { return &classic_keyboard; }
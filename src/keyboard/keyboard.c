@@ -61,13 +61,16 @@ void keyboard_push( char c ) {
     int real_index = keyboard_get_tail_index( process );
     process->keyboard.buffer[real_index] = c;
     process->keyboard.tail++;
+
+    // & wake anyone who's waiting for it
+    task_wake_all( &process->keyboard.waiters );
 }
 
 // popping a key, however, is done by ANY task (thread)
 char keyboard_pop() {
     // get the current process
     struct task* task = task_current();
-    if( !task ) return 0;
+    if( !task || !task->process ) return 0; // (the idle task has no process)
     struct process* process = task->process;
 
     // get the keyboard buffer's head
@@ -80,3 +83,12 @@ char keyboard_pop() {
     process->keyboard.head++;
     return c;
 }
+
+// sleeps until there's a key to pop
+char keyboard_pop_wait() {
+    struct task* task = task_current();
+    if( !task || !task->process ) return 0;
+    char c;
+    while( !(c = keyboard_pop()) ) task_wait( &task->process->keyboard.waiters );
+    return c;
+}
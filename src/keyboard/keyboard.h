@@ -24,6 +24,7 @@ void keyboard_init();
 void keyboard_backspace( struct process* process );
 void keyboard_push( char c );
 char keyboard_pop();
+char keyboard_pop_wait(); // blocks the current task until a key arrives
 
 // capslock getter/setter
 KEYBOARD_CAPS_LOCK_STATE keyboard_get_capslock( struct keyboard* keyboard );
@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include "memory/memory.h"
 #include "memory/heap/kheap.h"
+#include "memory/frame/frame.h"
 #include "string/string.h"
 #include "memory/paging/paging.h"
 #include "kernel.h"
@@ -144,8 +145,11 @@ int elf_load( const char* filename, struct elf_file** file_out ) {
     struct elf_file* elf_file = kzalloc( sizeof( struct elf_file ) );
     if( NULL == elf_file ) { res = -ENOMEM; goto out; }
 
-    // allocate enough heap memory for the entire file
-    elf_file->elf_memory = kzalloc( stat.filesize );
+    // allocate enough frames for the entire file (page-aligned, since segments get mapped straight into processes)
+    // (the image is parsed in place, so it has to be 1 contiguous run)
+    if( stat.filesize > FRAME_MAX_ALLOCATION ) { res = -EFBIG; goto out; }
+    elf_file->in_memory_size = stat.filesize;
+    elf_file->elf_memory = frame_zalloc_pages( stat.filesize );
     if( NULL == elf_file->elf_memory ) { res = -ENOMEM; goto out; }
 
     // read the file into memory
@@ -166,6 +170,10 @@ out:
 
 void elf_close( struct elf_file* file ) {
     if( !file ) return;
-    if( file->elf_memory ) kfree( file->elf_memory );
+    if( file->references ) { file->references--; return; }
+    if( file->elf_memory ) frame_free_pages( file->elf_memory, file->in_memory_size );
     kfree( file );
 }
+
+// forked processes run from the same loaded image (each one closes it)
+struct elf_file* elf_share( struct elf_file* file ) { file->references++; return file; }
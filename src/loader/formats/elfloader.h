@@ -13,11 +13,13 @@ struct elf_file {
     void* virtual_end_address;
     void* physical_base_address;
     void* physical_end_address;
+    int references; // extra processes sharing this file (it's freed when the last one closes it)
 };
 
 // functions
 int elf_load( const char* filename, struct elf_file** file_out );
 void elf_close( struct elf_file* file );
+struct elf_file* elf_share( struct elf_file* file );
 void* elf_virtual_base( struct elf_file* file );
 void* elf_virtual_end( struct elf_file* file );
 void* elf_physical_base( struct elf_file* file );
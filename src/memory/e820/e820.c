@@ -0,0 +1,123 @@
+#include "e820.h"
+
+// sorted, non-overlapping usable ranges
+static struct e820_range e820_ranges[PEACHOS_MEMORY_MAP_MAX_ENTRIES];
+static int e820_range_count = 0;
+static uint32_t e820_end = 0; // end of the highest usable range (before anything gets reserved)
+static uint64_t e820_clipped = 0; // usable bytes the BIOS reported above PEACHOS_MAX_PHYSICAL_ADDRESS (which the kernel can't reach)
+
+// inserts [start, end) in sorted order, merging it w/ any range it touches
+static void e820_add_range( uint32_t start, uint32_t end ) {
+    if( start >= end || e820_range_count >= PEACHOS_MEMORY_MAP_MAX_ENTRIES ) return;
+    int i = 0;
+    while( i < e820_range_count && e820_ranges[i].end < start ) i++;
+
+    // merge w/ overlapping or adjacent ranges
+    if( i < e820_range_count && e820_ranges[i].start <= end ) {
+        if( start < e820_ranges[i].start ) e820_ranges[i].start = start;
+        if( end > e820_ranges[i].end ) e820_ranges[i].end = end;
+        while( i + 1 < e820_range_count && e820_ranges[i + 1].start <= e820_ranges[i].end ) {
+            if( e820_ranges[i + 1].end > e820_ranges[i].end ) e820_ranges[i].end = e820_ranges[i + 1].end;
+            for( int j = i + 1; j < e820_range_count - 1; j++ ) e820_ranges[j] = e820_ranges[j + 1];
+            e820_range_count--;
+        }
+        return;
+    }
+
+    // insert a new range
+    for( int j = e820_range_count; j > i; j-- ) e820_ranges[j] = e820_ranges[j - 1];
+    e820_ranges[i].start = start;
+    e820_ranges[i].end = end;
+    e820_range_count++;
+}
+
+// removes [start, end) from the usable ranges (BIOS maps may list reserved regions that overlap usable ones)
+void e820_reserve( uint32_t start, uint32_t end ) {
+    for( int i = 0; i < e820_range_count; i++ ) {
+        struct e820_range* range = &e820_ranges[i];
+        if( end <= range->start || start >= range->end ) continue;
+
+        // split the range in two if the hole is in the middle
+        if( start > range->start && end < range->end ) {
+            uint32_t tail_start = end, tail_end = range->end;
+            range->end = start;
+            e820_add_range( tail_start, tail_end );
+            return;
+        }
+
+        // otherwise trim one side (or drop it entirely)
+        if( start <= range->start ) range->start = end < range->end ? end : range->end;
+        if( end >= range->end ) range->end = start > range->start ? start : range->start;
+        if( range->start >= range->end ) {
+            for( int j = i; j < e820_range_count - 1; j++ ) e820_ranges[j] = e820_ranges[j + 1];
+            e820_range_count--;
+            i--;
+        }
+    }
+}
+
+// clips a BIOS entry to page-aligned 32-bit addresses above the low memory the kernel itself uses
+static bool e820_clip( struct e820_entry* entry, uint32_t* start_out, uint32_t* end_out, bool shrink ) {
+    uint64_t start = entry->base, end = entry->base + entry->length, mask = ~(uint64_t)(PEACHOS_FRAME_SIZE - 1);
+
+    // usable ranges shrink inwards to whole pages, reserved ones grow outwards
+    if( shrink ) { start = (start + PEACHOS_FRAME_SIZE - 1) & mask; end&= mask; }
+    else { start&= mask; end = (end + PEACHOS_FRAME_SIZE - 1) & mask; }
+
+    // clip to what the kernel can hand out (keeping count of the usable RAM that's lost off the top)
+    if( start < PEACHOS_HEAP_ADDRESS ) start = PEACHOS_HEAP_ADDRESS;
+    if( end > PEACHOS_MAX_PHYSICAL_ADDRESS ) {
+        if( shrink && end > start ) e820_clipped+= end - (start > PEACHOS_MAX_PHYSICAL_ADDRESS ? start : PEACHOS_MAX_PHYSICAL_ADDRESS);
+        end = PEACHOS_MAX_PHYSICAL_ADDRESS;
+    }
+    if( start >= end ) return false;
+    *start_out = (uint32_t)start;
+    *end_out = (uint32_t)end;
+    return true;
+}
+
+// builds the usable ranges from the BIOS map (returns false, and falls back to the default layout, if there is no map)
+bool e820_init( struct e820_map* map ) {
+    e820_range_count = 0;
+    e820_clipped = 0;
+    if( !map || 0 == map->count || map->count > PEACHOS_MEMORY_MAP_MAX_ENTRIES ) {
+        e820_add_range( PEACHOS_HEAP_ADDRESS, PEACHOS_DEFAULT_MEMORY_END );
+        e820_end = PEACHOS_DEFAULT_MEMORY_END;
+        return false;
+    }
+
+    // add usable regions, then punch out anything the BIOS also marked as reserved (skipping entries the BIOS says to ignore)
+    uint32_t start, end;
+    for( int i = 0; i < map->count; i++ )
+        if( (E820_ACPI_ENABLED & map->entries[i].acpi) && E820_TYPE_USABLE == map->entries[i].type && e820_clip( &map->entries[i], &start, &end, true ) )
+            e820_add_range( start, end );
+    for( int i = 0; i < map->count; i++ )
+        if( (E820_ACPI_ENABLED & map->entries[i].acpi) && E820_TYPE_USABLE != map->entries[i].type && e820_clip( &map->entries[i], &start, &end, false ) )
+            e820_reserve( start, end );
+    e820_end = e820_range_count ? e820_ranges[e820_range_count - 1].end : PEACHOS_HEAP_ADDRESS;
+    return true;
+}
+
+int e820_total_ranges() { return e820_range_count; }
+
+struct e820_range* e820_range( int index ) {
+    if( index < 0 || index >= e820_range_count ) return NULL;
+    return &e820_ranges[index];
+}
+
+uint32_t e820_total_usable() {
+    uint32_t total = 0;
+    for( int i = 0; i < e820_range_count; i++ ) total+= e820_ranges[i].end - e820_ranges[i].start;
+    return total;
+}
+
+struct e820_range* e820_largest_range() {
+    struct e820_range* largest = NULL;
+    for( int i = 0; i < e820_range_count; i++ )
+        if( !largest || e820_ranges[i].end - e820_ranges[i].start > largest->end - largest->start ) largest = &e820_ranges[i];
+    return largest;
+}
+
+uint32_t e820_memory_end() { return e820_end; }
+
+uint32_t e820_clipped_kb() { return (uint32_t)(e820_clipped >> 10); }
@@ -0,0 +1,42 @@
+// https://wiki.osdev.org/Detecting_Memory_(x86)#BIOS_Function:_INT_0x15.2C_EAX_.3D_0xE820
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "config.h"
+
+// region types reported by the BIOS
+#define E820_TYPE_USABLE 1
+#define E820_TYPE_RESERVED 2
+#define E820_TYPE_ACPI_RECLAIMABLE 3
+#define E820_TYPE_ACPI_NVS 4
+#define E820_TYPE_BAD 5
+
+// ACPI 3.0 extended attribute bits
+#define E820_ACPI_ENABLED 0x1 // clear = ignore the entry (boot.asm presets it, so 20-byte entries count as enabled)
+
+// memory map, as collected by boot.asm @ PEACHOS_MEMORY_MAP_ADDRESS before entering protected mode
+struct e820_entry {
+    uint64_t base;
+    uint64_t length;
+    uint32_t type;
+    uint32_t acpi; // ACPI 3.0 extended attributes
+} __attribute__((packed));
+
+struct e820_map {
+    uint32_t count;
+    struct e820_entry entries[PEACHOS_MEMORY_MAP_MAX_ENTRIES];
+} __attribute__((packed));
+
+// page-aligned range of usable RAM that the kernel may hand out (never below PEACHOS_HEAP_ADDRESS)
+struct e820_range { uint32_t start, end; };
+
+// functions
+bool e820_init( struct e820_map* map );
+void e820_reserve( uint32_t start, uint32_t end );
+int e820_total_ranges();
+struct e820_range* e820_range( int index );
+uint32_t e820_total_usable();
+struct e820_range* e820_largest_range();
+uint32_t e820_memory_end();
+uint32_t e820_clipped_kb(); // usable RAM ignored b/c it's above PEACHOS_MAX_PHYSICAL_ADDRESS
@@ -0,0 +1,124 @@
+#include "buddy.h"
+#include "status.h"
+#include "memory/memory.h"
+#include <stdbool.h>
+
+static bool buddy_validate_alignment( void* p ) { return 0 == ((uint32_t)p % PEACHOS_FRAME_SIZE); }
+
+// every frame starts out reserved, and usable memory is handed over w/ buddy_add_range()
+int buddy_create( struct buddy* buddy, void* start, void* end, BUDDY_FRAME_ENTRY* frames ) {
+    if( !buddy_validate_alignment( start ) || !buddy_validate_alignment( end ) || end < start ) return -EINVARG;
+    memset( buddy, 0, sizeof( struct buddy ) );
+    buddy->start = start;
+    buddy->total = (size_t)(end - start) / PEACHOS_FRAME_SIZE;
+    buddy->frames = frames;
+    memset( frames, 0, buddy->total * sizeof( BUDDY_FRAME_ENTRY ) );
+    return 0;
+}
+
+static void* buddy_frame_to_address( struct buddy* buddy, size_t frame ) { return buddy->start + frame * PEACHOS_FRAME_SIZE; }
+static size_t buddy_address_to_frame( struct buddy* buddy, void* p ) { return (size_t)(p - buddy->start) / PEACHOS_FRAME_SIZE; }
+
+// smallest order whose block holds 'size' bytes (or -ENOMEM if it's larger than the largest block)
+int buddy_order_for_size( size_t size ) {
+    size_t frames = (size + PEACHOS_FRAME_SIZE - 1) / PEACHOS_FRAME_SIZE;
+    for( int order = 0; order <= BUDDY_MAX_ORDER; order++ )
+        if( frames <= (1u << order) ) return order;
+    return -ENOMEM;
+}
+
+// -- free lists --
+
+static void buddy_list_insert( struct buddy* buddy, size_t frame, int order ) {
+    struct buddy_free_block* block = buddy_frame_to_address( buddy, frame );
+    block->prev = NULL;
+    block->next = buddy->free_lists[order];
+    if( block->next ) block->next->prev = block;
+    buddy->free_lists[order] = block;
+    buddy->frames[frame] = BUDDY_FRAME_FREE | order;
+}
+
+static void buddy_list_remove( struct buddy* buddy, size_t frame, int order ) {
+    struct buddy_free_block* block = buddy_frame_to_address( buddy, frame );
+    if( block->prev ) block->prev->next = block->next; else buddy->free_lists[order] = block->next;
+    if( block->next ) block->next->prev = block->prev;
+    buddy->frames[frame] = 0;
+}
+
+// -- allocation --
+
+void* buddy_alloc( struct buddy* buddy, int order ) {
+    if( order < 0 || order > BUDDY_MAX_ORDER ) return NULL;
+
+    // find the smallest free block that is big enough
+    int current = order;
+    while( current <= BUDDY_MAX_ORDER && !buddy->free_lists[current] ) current++;
+    if( current > BUDDY_MAX_ORDER ) return NULL;
+    size_t frame = buddy_address_to_frame( buddy, buddy->free_lists[current] );
+    buddy_list_remove( buddy, frame, current );
+
+    // split it in halves, giving the upper half back each time, until it's the requested size
+    while( current > order ) {
+        current--;
+        buddy_list_insert( buddy, frame + (1u << current), current );
+    }
+
+    // mark the block as taken
+    buddy->frames[frame] = BUDDY_FRAME_TAKEN | order;
+    buddy->free-= 1u << order;
+    return buddy_frame_to_address( buddy, frame );
+}
+
+void buddy_free( struct buddy* buddy, void* p ) {
+    // only the head of an allocated block can be freed
+    if( p < buddy->start || !buddy_validate_alignment( p ) ) return;
+    size_t frame = buddy_address_to_frame( buddy, p );
+    if( frame >= buddy->total || !(BUDDY_FRAME_TAKEN & buddy->frames[frame]) ) return;
+    int order = BUDDY_FRAME_ORDER_MASK & buddy->frames[frame];
+    buddy->frames[frame] = 0;
+    buddy->free+= 1u << order;
+
+    // merge w/ the buddy block for as long as it is also free (and the same size)
+    while( order < BUDDY_MAX_ORDER ) {
+        size_t buddy_frame = frame ^ (1u << order);
+        if( buddy_frame + (1u << order) > buddy->total || (BUDDY_FRAME_FREE | order) != buddy->frames[buddy_frame] ) break;
+        buddy_list_remove( buddy, buddy_frame, order );
+        if( buddy_frame < frame ) frame = buddy_frame;
+        order++;
+    }
+    buddy_list_insert( buddy, frame, order );
+}
+
+// a run of exactly 'count' frames: it's carved from the smallest block that fits, & the block's unused tail is given straight back
+void* buddy_alloc_pages( struct buddy* buddy, size_t count ) {
+    int order = buddy_order_for_size( count * PEACHOS_FRAME_SIZE );
+    if( 0 == count || order < 0 ) return NULL;
+    void* p = buddy_alloc( buddy, order );
+    if( !p ) return NULL;
+    buddy->frames[buddy_address_to_frame( buddy, p )] = BUDDY_FRAME_RUN;
+    buddy_add_range( buddy, p + count * PEACHOS_FRAME_SIZE, p + ((size_t)PEACHOS_FRAME_SIZE << order) );
+    return p;
+}
+
+// 'count' must match the allocation (the run's length isn't recorded)
+void buddy_free_pages( struct buddy* buddy, void* p, size_t count ) {
+    if( p < buddy->start || !buddy_validate_alignment( p ) ) return;
+    size_t frame = buddy_address_to_frame( buddy, p );
+    if( frame >= buddy->total || BUDDY_FRAME_RUN != buddy->frames[frame] ) return;
+    buddy->frames[frame] = 0;
+    buddy_add_range( buddy, p, p + count * PEACHOS_FRAME_SIZE );
+}
+
+// hands the frames in [start, end) over to the allocator as the largest aligned blocks that fit
+void buddy_add_range( struct buddy* buddy, void* start, void* end ) {
+    if( start < buddy->start ) start = buddy->start;
+    if( end > buddy_frame_to_address( buddy, buddy->total ) ) end = buddy_frame_to_address( buddy, buddy->total );
+    size_t frame = buddy_address_to_frame( buddy, start + PEACHOS_FRAME_SIZE - 1 ), end_frame = buddy_address_to_frame( buddy, end );
+    while( frame < end_frame ) {
+        int order = BUDDY_MAX_ORDER;
+        while( order > 0 && ((frame & ((1u << order) - 1)) || frame + (1u << order) > end_frame) ) order--;
+        buddy->frames[frame] = BUDDY_FRAME_TAKEN | order;
+        buddy_free( buddy, buddy_frame_to_address( buddy, frame ) );
+        frame+= 1u << order;
+    }
+}
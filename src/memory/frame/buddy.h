@@ -0,0 +1,34 @@
+// https://en.wikipedia.org/wiki/Buddy_memory_allocation
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "config.h"
+
+#define BUDDY_MAX_ORDER 14 // largest block = 2^14 frames (64 MB), which also caps a run from buddy_alloc_pages
+
+// per-frame state byte (only meaningful for the 1st frame of a block)
+#define BUDDY_FRAME_FREE 0x80 // head of a free block
+#define BUDDY_FRAME_TAKEN 0x40 // head of an allocated block
+#define BUDDY_FRAME_RUN 0x20 // head of an allocated run (any number of frames, freed w/ buddy_free_pages)
+#define BUDDY_FRAME_ORDER_MASK 0x0F
+
+typedef uint8_t BUDDY_FRAME_ENTRY;
+
+// free blocks are kept in doubly linked lists that live inside the free memory itself
+struct buddy_free_block { struct buddy_free_block *next, *prev; };
+
+struct buddy {
+    void* start; // address of frame 0
+    size_t total; // total frames covered by 'frames'
+    size_t free; // total free frames
+    BUDDY_FRAME_ENTRY* frames; // one state byte per frame
+    struct buddy_free_block* free_lists[BUDDY_MAX_ORDER + 1]; // one list per block order
+};
+
+int buddy_create( struct buddy* buddy, void* start, void* end, BUDDY_FRAME_ENTRY* frames );
+void buddy_add_range( struct buddy* buddy, void* start, void* end );
+int buddy_order_for_size( size_t size );
+void* buddy_alloc( struct buddy* buddy, int order );
+void buddy_free( struct buddy* buddy, void* p );
+void* buddy_alloc_pages( struct buddy* buddy, size_t count );
+void buddy_free_pages( struct buddy* buddy, void* p, size_t count );
@@ -0,0 +1,95 @@
+#include "frame.h"
+#include "buddy.h"
+#include "config.h"
+#include "kernel.h"
+#include "memory/memory.h"
+#include "memory/heap/kheap.h"
+#include "memory/e820/e820.h"
+
+struct buddy frame_pool;
+static uint16_t* frame_shares; // extra references per frame (0 = just the one owner), for copy-on-write sharing
+
+void frame_init() {
+    // one buddy allocator spans from the lowest to the highest usable frame (holes in between stay reserved)
+    // (frames are handed out as kernel pointers into the higher half window, so they can be used directly)
+    int total_ranges = e820_total_ranges();
+    if( 0 == total_ranges ) { print( "no usable memory for frame pool\n" ); return; }
+
+    // RAM above the kernel's 1 GB window can't be reached through PHYS_TO_VIRT, so e820 dropped it (say so, rather than silently running w/ less)
+    uint32_t clipped = e820_clipped_kb();
+    if( clipped ) { print( "warning: ignoring " ); print_number( clipped ); print( " KB of RAM above the kernel's physical memory window\n" ); }
+    void *start = PHYS_TO_VIRT( e820_range( 0 )->start ), *end = PHYS_TO_VIRT( e820_range( total_ranges - 1 )->end );
+
+    // per-frame state lives on the kernel heap
+    BUDDY_FRAME_ENTRY* frames = kzalloc( (end - start) / PEACHOS_FRAME_SIZE * sizeof( BUDDY_FRAME_ENTRY ) );
+    if( !frames || buddy_create( &frame_pool, start, end, frames ) < 0 ) { print( "failed to create frame pool\n" ); return; }
+    frame_shares = kzalloc( frame_pool.total * sizeof( uint16_t ) );
+    if( !frame_shares ) { print( "failed to create frame share counts\n" ); return; }
+
+    // hand over every usable range
+    for( int i = 0; i < total_ranges; i++ ) {
+        struct e820_range* range = e820_range( i );
+        buddy_add_range( &frame_pool, PHYS_TO_VIRT( range->start ), PHYS_TO_VIRT( range->end ) );
+    }
+}
+
+// allocates physically contiguous frames (rounded up to a power-of-two number of frames)
+void* frame_alloc( size_t size ) {
+    int order = buddy_order_for_size( size );
+    if( order < 0 ) return NULL;
+    return buddy_alloc( &frame_pool, order );
+}
+
+void* frame_zalloc( size_t size ) {
+    void* p = frame_alloc( size );
+    if( !p ) return NULL;
+    memset( p, 0, size );
+    return p;
+}
+
+// NULL for pointers outside the pool (or if the counts couldn't be allocated), which are ignored like buddy_free ignores invalid frees
+static uint16_t* frame_share_count( void* p ) {
+    if( !frame_shares || p < frame_pool.start ) return NULL;
+    size_t frame = (p - frame_pool.start) / PEACHOS_FRAME_SIZE;
+    return frame < frame_pool.total ? &frame_shares[frame] : NULL;
+}
+
+// adds a reference to a frame (each reference is dropped w/ frame_free)
+void frame_share( void* p ) {
+    uint16_t* shares = frame_share_count( p );
+    if( shares ) (*shares)++;
+}
+
+bool frame_is_shared( void* p ) {
+    uint16_t* shares = frame_share_count( p );
+    return shares && 0 != *shares;
+}
+
+// drops a reference, & frees the frame(s) once the last one is gone
+void frame_free( void* p ) {
+    if( !p ) return;
+    uint16_t* shares = frame_share_count( p );
+    if( shares && *shares ) { (*shares)--; return; }
+    buddy_free( &frame_pool, p ); // (does its own range checks)
+}
+
+static size_t frame_count( size_t size ) { return size ? (size + PEACHOS_FRAME_SIZE - 1) / PEACHOS_FRAME_SIZE : 1; }
+
+void* frame_alloc_pages( size_t size ) { return buddy_alloc_pages( &frame_pool, frame_count( size ) ); }
+
+void* frame_zalloc_pages( size_t size ) {
+    void* p = frame_alloc_pages( size );
+    if( !p ) return NULL;
+    memset( p, 0, size );
+    return p;
+}
+
+// (shares are counted on the run's 1st frame)
+void frame_free_pages( void* p, size_t size ) {
+    if( !p ) return;
+    uint16_t* shares = frame_share_count( p );
+    if( shares && *shares ) { (*shares)--; return; }
+    buddy_free_pages( &frame_pool, p, frame_count( size ) );
+}
+
+size_t frame_total_free() { return frame_pool.free * PEACHOS_FRAME_SIZE; }
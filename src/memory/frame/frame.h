@@ -0,0 +1,19 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "buddy.h"
+
+#define FRAME_MAX_ALLOCATION ((size_t)PEACHOS_FRAME_SIZE << BUDDY_MAX_ORDER) // largest contiguous allocation (e.g. a program image)
+
+// physical page frame allocator (buddy system), kept separate from the kernel heap
+void frame_init();
+void* frame_alloc( size_t size );
+void* frame_zalloc( size_t size );
+void frame_free( void* p ); // drops a reference (frees once nobody shares the frame)
+void* frame_alloc_pages( size_t size ); // exactly enough contiguous frames for 'size' (rather than a power of 2), for big buffers like program images
+void* frame_zalloc_pages( size_t size );
+void frame_free_pages( void* p, size_t size ); // (same 'size' as the allocation, & frame_free can't free these)
+void frame_share( void* p ); // adds a reference (for frames mapped into more than one address space)
+bool frame_is_shared( void* p );
+size_t frame_total_free();
@@ -13,6 +13,34 @@ static int heap_validate_table( void* start, void* end, struct heap_table* table
 
 static bool heap_validate_alignment( void* p ) { return 0 == ((uint32_t)p % PEACHOS_HEAP_BLOCK_SIZE); }
 
+// sets (free) or clears (taken) 'count' bits of the free map starting @ 'block', keeping the summary in sync
+static void heap_free_map_mark( struct heap_table* table, size_t block, size_t count, bool free ) {
+    for( size_t end = block + count; block < end; ) {
+        // build a mask for the bits of this word that fall inside the range
+        size_t word = block / 32, bit = block % 32, bits = 32 - bit;
+        if( bits > end - block ) bits = end - block;
+        uint32_t mask = (32 == bits ? 0xFFFFFFFF : ((1u << bits) - 1)) << bit;
+
+        // update the word & its summary bit
+        if( free ) table->free_map[word]|= mask; else table->free_map[word]&= ~mask;
+        if( table->free_map[word] ) table->free_summary[word / 32]|= 1u << (word % 32);
+        else table->free_summary[word / 32]&= ~(1u << (word % 32));
+        block+= bits;
+    }
+}
+
+// returns index of the first free map word >= 'word' that has a free block (or -1 if there are none)
+static int heap_free_map_next_word( struct heap_table* table, size_t word ) {
+    size_t total_words = HEAP_FREE_MAP_WORDS( table->total );
+    while( word < total_words ) {
+        // check the remainder of this summary word, skipping 1024 fully-taken blocks at a time
+        uint32_t summary = table->free_summary[word / 32] & (0xFFFFFFFF << (word % 32));
+        if( summary ) return (word & ~31) + __builtin_ctz( summary );
+        word = (word & ~31) + 32;
+    }
+    return -1;
+}
+
 int heap_create( struct heap* heap, void* start, void* end, struct heap_table* table ) {
     int res = 0;
 
@@ -35,6 +63,11 @@ int heap_create( struct heap* heap, void* start, void* end, struct heap_table* t
     size_t table_size = sizeof( HEAP_BLOCK_TABLE_ENTRY ) * table->total;
     memset( table->entries, HEAP_BLOCK_TABLE_ENTRY_FREE, table_size );
 
+    // every block starts out free in the free-space index
+    memset( table->free_map, 0, HEAP_FREE_MAP_WORDS( table->total ) * sizeof( uint32_t ) );
+    memset( table->free_summary, 0, HEAP_FREE_SUMMARY_WORDS( table->total ) * sizeof( uint32_t ) );
+    heap_free_map_mark( table, 0, table->total, true );
+
 out:
     return res;
 }
@@ -50,23 +83,36 @@ static int heap_get_entry_type( HEAP_BLOCK_TABLE_ENTRY entry ) { return entry &
 
 int heap_get_start_block( struct heap* heap, uint32_t total_blocks ) {
     struct heap_table* table = heap->table;
-    int bc = 0, bs = -1; // current block, block_start
-    for( size_t i = 0; i < table->total; i++ ) {
-        // check for reset
-        if( HEAP_BLOCK_TABLE_ENTRY_FREE != heap_get_entry_type( table->entries[i] ) ) {
-            bc = 0; bs = -1; continue;
+
+    // walk the free map a word at a time, tracking the current run of free blocks
+    int total_words = HEAP_FREE_MAP_WORDS( table->total ), word = heap_free_map_next_word( table, 0 );
+    uint32_t run = 0, run_start = 0;
+    while( word >= 0 && word < total_words ) {
+        uint32_t bits = table->free_map[word];
+
+        // single blocks (the common case) are just the lowest set bit of the first non-empty word
+        if( total_blocks <= 1 ) return word * 32 + __builtin_ctz( bits );
+
+        // fully taken word breaks the run, so use the summary to skip ahead to the next free block
+        if( 0 == bits ) { run = 0; word = heap_free_map_next_word( table, word + 1 ); continue; }
+
+        // fully free word extends the run by 32 blocks
+        if( 0xFFFFFFFF == bits ) {
+            if( 0 == run ) run_start = word * 32;
+            if( (run+= 32) >= total_blocks ) return run_start;
+            word++;
+            continue;
         }
-        
-        // check for start
-        if( -1 == bs ) bs = i;
 
-        // check for end
-        if( ++bc == total_blocks ) break;
+        // partially free word: extend/reset the run bit by bit
+        for( int bit = 0; bit < 32; bit++ ) {
+            if( !(bits & (1u << bit)) ) { run = 0; continue; }
+            if( 0 == run ) run_start = word * 32 + bit;
+            if( ++run == total_blocks ) return run_start;
+        }
+        word++;
     }
-
-    // return either no-memory error or start block
-    if( -1 == bs ) return -ENOMEM;
-    return bs;
+    return -ENOMEM;
 }
 
 void* heap_block_to_address( struct heap* heap, int block ) {
@@ -84,6 +130,9 @@ void heap_mark_blocks_taken( struct heap* heap, int start_block, int total_block
         entry = HEAP_BLOCK_TABLE_ENTRY_TAKEN;
         if( end_block - 1 != i ) entry|=HEAP_BLOCK_HAS_NEXT;
     }
+
+    // remove the blocks from the free-space index
+    heap_free_map_mark( heap->table, start_block, total_blocks, false );
 }
 
 void* heap_malloc_blocks( struct heap* heap, uint32_t total_blocks ) {
@@ -112,11 +161,16 @@ int heap_address_to_block( struct heap* heap, void* address ) {
 
 void heap_mark_blocks_free( struct heap* heap, int start_block ) {
     struct heap_table* table = heap->table;
-    for( int i = start_block; i < (int)table->total; i++ ) {
+    int i;
+    for( i = start_block; i < (int)table->total; i++ ) {
         HEAP_BLOCK_TABLE_ENTRY entry = table->entries[i];
         table->entries[i] = HEAP_BLOCK_TABLE_ENTRY_FREE;
         if( !( HEAP_BLOCK_HAS_NEXT & entry ) ) break;
     }
+
+    // return the blocks to the free-space index
+    if( i >= (int)table->total ) i = table->total - 1;
+    heap_free_map_mark( table, start_block, i - start_block + 1, true );
 }
 
 void heap_free( struct heap* heap, void* p ) {
@@ -129,3 +183,31 @@ void* heap_clone( struct heap* heap, void* buffer, size_t size ) {
     memcpy( clone, buffer, size );
     return clone;
 }
+
+static bool heap_contains( struct heap* heap, void* p ) {
+    return p >= heap->start && p < heap->start + heap->table->total * PEACHOS_HEAP_BLOCK_SIZE;
+}
+
+// returns the entry type of the block containing 'p' (HEAP_BLOCK_TABLE_ENTRY_FREE, _TAKEN, _SLAB)
+int heap_get_address_type( struct heap* heap, void* p ) {
+    if( !heap_contains( heap, p ) ) return -EINVARG;
+    return heap_get_entry_type( heap->table->entries[heap_address_to_block( heap, p )] );
+}
+
+// re-tags every block of the allocation starting @ 'p' (keeps the first/next bits intact)
+void heap_set_allocation_type( struct heap* heap, void* p, HEAP_BLOCK_TABLE_ENTRY type ) {
+    struct heap_table* table = heap->table;
+    for( int i = heap_address_to_block( heap, p ); i < (int)table->total; i++ ) {
+        HEAP_BLOCK_TABLE_ENTRY entry = table->entries[i];
+        table->entries[i] = (entry & ~0xF) | type;
+        if( !( HEAP_BLOCK_HAS_NEXT & entry ) ) break;
+    }
+}
+
+// finds the start of the allocation that contains 'p' (which may point anywhere inside it)
+void* heap_get_allocation_start( struct heap* heap, void* p ) {
+    if( !heap_contains( heap, p ) ) return NULL;
+    int block = heap_address_to_block( heap, p );
+    while( block > 0 && !(HEAP_BLOCK_IS_FIRST & heap->table->entries[block]) ) block--;
+    return heap_block_to_address( heap, block );
+}
@@ -6,14 +6,21 @@
 
 #define HEAP_BLOCK_TABLE_ENTRY_FREE  0x00
 #define HEAP_BLOCK_TABLE_ENTRY_TAKEN 0x01
+#define HEAP_BLOCK_TABLE_ENTRY_SLAB  0x02 // taken, and owned by the slab layer (see slab.h)
 #define HEAP_BLOCK_HAS_NEXT 0b10000000
 #define HEAP_BLOCK_IS_FIRST 0b01000000
 
 typedef uint8_t HEAP_BLOCK_TABLE_ENTRY;
 
+// free-space index: one bit per block (1 = free), plus one summary bit per free map word (1 = word has a free block)
+#define HEAP_FREE_MAP_WORDS( total_blocks ) (((total_blocks) + 31) / 32)
+#define HEAP_FREE_SUMMARY_WORDS( total_blocks ) ((HEAP_FREE_MAP_WORDS( total_blocks ) + 31) / 32)
+
 struct heap_table {
     HEAP_BLOCK_TABLE_ENTRY* entries;
     size_t total;
+    uint32_t* free_map; // HEAP_FREE_MAP_WORDS( total ) words, scanned a word at a time
+    uint32_t* free_summary; // HEAP_FREE_SUMMARY_WORDS( total ) words, lets us skip fully-taken regions 1024 blocks at a time
 };
 
 struct heap {
@@ -25,3 +32,8 @@ int heap_create( struct heap* heap, void* start, void* end, struct heap_table* t
 void* heap_malloc( struct heap* heap, size_t size );
 void heap_free( struct heap* heap, void* p );
 void* heap_clone( struct heap* heap, void* buffer, size_t size );
+
+// allocation introspection (used by layers built on top of the heap, like the slab allocator)
+int heap_get_address_type( struct heap* heap, void* p );
+void heap_set_allocation_type( struct heap* heap, void* p, HEAP_BLOCK_TABLE_ENTRY type );
+void* heap_get_allocation_start( struct heap* heap, void* p );
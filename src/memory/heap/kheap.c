@@ -1,26 +1,62 @@
 #include "kheap.h"
 #include "heap.h"
+#include "slab.h"
 #include "config.h"
 #include "kernel.h"
 #include "memory/memory.h"
+#include "memory/e820/e820.h"
 
 struct heap kernel_heap;
 struct heap_table kernel_heap_table;
 
+// the block table & free-space index need ~289 bytes per 256 blocks, and must fit in low memory
+static size_t kheap_max_blocks() {
+    size_t available = PEACHOS_HEAP_TABLE_END_ADDRESS - PEACHOS_HEAP_TABLE_ADDRESS - 16; // 16 = alignment slack
+    return available / 289 * 256;
+}
+
+// the heap scales w/ the machine: a fraction of usable RAM, bounded by the range it lives in & the table capacity
+static size_t kheap_pick_size( struct e820_range* range ) {
+    size_t size = e820_total_usable() / PEACHOS_HEAP_RAM_DIVISOR;
+    if( size < PEACHOS_HEAP_MIN_SIZE_BYTES ) size = PEACHOS_HEAP_MIN_SIZE_BYTES;
+    if( size > range->end - range->start ) size = range->end - range->start;
+    if( size / PEACHOS_HEAP_BLOCK_SIZE > kheap_max_blocks() ) size = kheap_max_blocks() * PEACHOS_HEAP_BLOCK_SIZE;
+    return size - size % PEACHOS_HEAP_BLOCK_SIZE;
+}
+
 void kheap_init() {
-    // initialize kernel_heap_table
-    kernel_heap_table.entries = (HEAP_BLOCK_TABLE_ENTRY*)PEACHOS_HEAP_TABLE_ADDRESS;
-    kernel_heap_table.total = PEACHOS_HEAP_SIZE_BYTES / PEACHOS_HEAP_BLOCK_SIZE;
+    // the heap goes @ the start of the largest usable range of RAM
+    struct e820_range* range = e820_largest_range();
+    if( !range ) { print( "no usable memory for kernel heap\n" ); return; }
+    uint32_t heap_start = range->start, heap_size = kheap_pick_size( range );
+
+    // initialize kernel_heap_table (the heap & its table are addressed through the kernel's window onto physical memory)
+    kernel_heap_table.entries = PHYS_TO_VIRT( PEACHOS_HEAP_TABLE_ADDRESS );
+    kernel_heap_table.total = heap_size / PEACHOS_HEAP_BLOCK_SIZE;
+
+    // the free-space index lives right after the block table entries (word aligned)
+    uint32_t free_map_address = (PEACHOS_HEAP_TABLE_ADDRESS + kernel_heap_table.total + 3) & ~3;
+    kernel_heap_table.free_map = PHYS_TO_VIRT( free_map_address );
+    kernel_heap_table.free_summary = kernel_heap_table.free_map + HEAP_FREE_MAP_WORDS( kernel_heap_table.total );
     
     // initialize kernel_heap
-    void* end = (void*)(PEACHOS_HEAP_ADDRESS + PEACHOS_HEAP_SIZE_BYTES);
-    int res = heap_create( &kernel_heap, (void*)PEACHOS_HEAP_ADDRESS, end, &kernel_heap_table );
+    int res = heap_create( &kernel_heap, PHYS_TO_VIRT( heap_start ), PHYS_TO_VIRT( heap_start + heap_size ), &kernel_heap_table );
     
     // check for error
-    if( res < 0 ) print( "failed to create kernel heap\n" );
+    if( res < 0 ) { print( "failed to create kernel heap\n" ); return; }
+
+    // the frame allocator gets whatever RAM is left
+    e820_reserve( heap_start, heap_start + heap_size );
+
+    // small objects are served by slab caches carved out of the kernel heap
+    slab_init( &kernel_heap );
 }
 
-void* kmalloc( size_t size ) { return heap_malloc( &kernel_heap, size ); }
+// small requests go to the matching slab size class, everything else gets whole heap blocks
+void* kmalloc( size_t size ) {
+    struct slab_cache* cache = slab_cache_for_size( size );
+    return cache ? slab_alloc( cache ) : heap_malloc( &kernel_heap, size );
+}
 
 void* kzalloc( size_t size ) {
     void* p = kmalloc( size );
@@ -29,6 +65,10 @@ void* kzalloc( size_t size ) {
     return p;
 }
 
-void kfree( void* p ) { heap_free( &kernel_heap, p ); }
+void kfree( void* p ) {
+    if( !p ) return;
+    if( slab_owns( p ) ) slab_free( p );
+    else heap_free( &kernel_heap, p );
+}
 
 void* kheap_clone( void* buffer, size_t size ) { return heap_clone( &kernel_heap, buffer, size ); }
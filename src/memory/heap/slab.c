@@ -0,0 +1,167 @@
+#include "slab.h"
+#include "heap.h"
+#include "config.h"
+#include "kernel.h"
+#include "memory/memory.h"
+
+// heap that the slabs are carved out of
+static struct heap* slab_heap = NULL;
+
+// kmalloc size classes
+static struct slab_cache slab_size_caches[] = {
+    SLAB_CACHE( "size-8", 8 ), SLAB_CACHE( "size-16", 16 ), SLAB_CACHE( "size-32", 32 ),
+    SLAB_CACHE( "size-64", 64 ), SLAB_CACHE( "size-128", 128 ), SLAB_CACHE( "size-256", 256 ),
+    SLAB_CACHE( "size-512", 512 ), SLAB_CACHE( "size-1024", 1024 ), SLAB_CACHE( "size-2048", SLAB_MAX_SIZE_CLASS )
+};
+#define SLAB_TOTAL_SIZE_CACHES (sizeof( slab_size_caches ) / sizeof( struct slab_cache ))
+
+// registry of every cache that has been set up
+static struct slab_cache* slab_caches = NULL;
+
+// objects are 8-byte aligned, and the slab header is padded so the 1st object is too
+static size_t slab_align( size_t size ) { return (size + 7) & ~7; }
+static size_t slab_header_size() { return slab_align( sizeof( struct slab ) ); }
+
+// lazily compute slab geometry & register the cache (lets per-type caches be defined statically)
+static void slab_cache_setup( struct slab_cache* cache ) {
+    if( cache->slab_size ) return;
+    cache->object_size = slab_align( cache->object_size < sizeof( void* ) ? sizeof( void* ) : cache->object_size );
+    size_t bytes = slab_header_size() + cache->object_size * SLAB_MIN_OBJECTS_PER_SLAB;
+    cache->slab_size = (bytes + PEACHOS_HEAP_BLOCK_SIZE - 1) / PEACHOS_HEAP_BLOCK_SIZE * PEACHOS_HEAP_BLOCK_SIZE;
+    cache->next = slab_caches;
+    slab_caches = cache;
+}
+
+void slab_init( struct heap* heap ) {
+    slab_heap = heap;
+    for( int i = SLAB_TOTAL_SIZE_CACHES - 1; i >= 0; i-- ) slab_cache_setup( &slab_size_caches[i] );
+}
+
+struct slab_cache* slab_cache_for_size( size_t size ) {
+    for( int i = 0; i < SLAB_TOTAL_SIZE_CACHES; i++ )
+        if( size <= slab_size_caches[i].object_size ) return &slab_size_caches[i];
+    return NULL;
+}
+
+// -- slab lists --
+
+static void slab_list_insert( struct slab** head, struct slab* slab ) {
+    slab->prev = NULL;
+    slab->next = *head;
+    if( *head ) (*head)->prev = slab;
+    *head = slab;
+}
+
+static void slab_list_remove( struct slab** head, struct slab* slab ) {
+    if( slab->prev ) slab->prev->next = slab->next; else *head = slab->next;
+    if( slab->next ) slab->next->prev = slab->prev;
+    slab->next = slab->prev = NULL;
+}
+
+// -- slab creation & destruction --
+
+static struct slab* slab_new( struct slab_cache* cache ) {
+    // grab a run of heap blocks & tag them, so kfree can tell slab objects apart from plain heap allocations
+    struct slab* slab = heap_malloc( slab_heap, cache->slab_size );
+    if( !slab ) return NULL;
+    heap_set_allocation_type( slab_heap, slab, HEAP_BLOCK_TABLE_ENTRY_SLAB );
+
+    // thread every object onto the free list
+    memset( slab, 0, sizeof( struct slab ) );
+    slab->cache = cache;
+    slab->total = (cache->slab_size - slab_header_size()) / cache->object_size;
+    for( int i = slab->total - 1; i >= 0; i-- ) {
+        void** object = (void**)((uint8_t*)slab + slab_header_size() + i * cache->object_size);
+        *object = slab->free_list;
+        slab->free_list = object;
+    }
+
+    // update statistics
+    cache->total_slabs++;
+    cache->total_objects+= slab->total;
+    return slab;
+}
+
+static void slab_destroy( struct slab* slab ) {
+    struct slab_cache* cache = slab->cache;
+    cache->total_slabs--;
+    cache->total_objects-= slab->total;
+    heap_free( slab_heap, slab );
+}
+
+// -- allocation --
+
+void* slab_alloc( struct slab_cache* cache ) {
+    slab_cache_setup( cache );
+
+    // use a partially filled slab, or grow the cache by one slab
+    struct slab* slab = cache->partial;
+    if( !slab ) {
+        if( !(slab = slab_new( cache )) ) return NULL;
+        slab_list_insert( &cache->partial, slab );
+    }
+
+    // pop an object
+    void** object = slab->free_list;
+    slab->free_list = *object;
+    slab->used++;
+    cache->used_objects++;
+
+    // move slab onto the full list once it runs out of objects
+    if( slab->used == slab->total ) {
+        slab_list_remove( &cache->partial, slab );
+        slab_list_insert( &cache->full, slab );
+    }
+    return object;
+}
+
+void* slab_zalloc( struct slab_cache* cache ) {
+    void* p = slab_alloc( cache );
+    if( !p ) return NULL;
+    memset( p, 0, cache->object_size );
+    return p;
+}
+
+bool slab_owns( void* p ) {
+    return slab_heap && HEAP_BLOCK_TABLE_ENTRY_SLAB == heap_get_address_type( slab_heap, p );
+}
+
+void slab_free( void* p ) {
+    // the slab header sits at the start of the heap allocation that contains 'p'
+    struct slab* slab = heap_get_allocation_start( slab_heap, p );
+    if( !slab ) return;
+    struct slab_cache* cache = slab->cache;
+
+    // full slabs become partial again
+    if( slab->used == slab->total ) {
+        slab_list_remove( &cache->full, slab );
+        slab_list_insert( &cache->partial, slab );
+    }
+
+    // push the object back onto the free list
+    *(void**)p = slab->free_list;
+    slab->free_list = p;
+    slab->used--;
+    cache->used_objects--;
+
+    // give empty slabs back to the heap, but keep the last one around to avoid thrashing
+    if( 0 == slab->used && (slab->next || slab->prev) ) {
+        slab_list_remove( &cache->partial, slab );
+        slab_destroy( slab );
+    }
+}
+
+// -- statistics --
+
+int slab_get_stats( struct slab_stats* stats, int max ) {
+    int i = 0;
+    for( struct slab_cache* cache = slab_caches; cache && i < max; cache = cache->next, i++ ) {
+        stats[i].name = cache->name;
+        stats[i].object_size = cache->object_size;
+        stats[i].slabs = cache->total_slabs;
+        stats[i].used_objects = cache->used_objects;
+        stats[i].total_objects = cache->total_objects;
+        stats[i].bytes = cache->total_slabs * cache->slab_size;
+    }
+    return i;
+}
@@ -0,0 +1,47 @@
+// https://en.wikipedia.org/wiki/Slab_allocation
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+struct heap;
+
+#define SLAB_MIN_OBJECTS_PER_SLAB 4 // slabs are sized (in heap blocks) to hold at least this many objects
+#define SLAB_MAX_SIZE_CLASS 2048 // kmalloc requests larger than this go straight to the heap
+
+// a slab is one heap allocation carved into equal sized objects, w/ this header at its start
+struct slab {
+    struct slab_cache* cache;
+    struct slab *next, *prev; // siblings in the cache's partial/full list
+    void* free_list; // singly linked list of free objects (the link lives in the free object itself)
+    uint16_t used, total;
+};
+
+// a cache hands out objects of one size (either a kmalloc size class or a specific kernel type)
+struct slab_cache {
+    const char* name;
+    size_t object_size;
+    size_t slab_size; // bytes per slab (computed on first use)
+    struct slab *partial, *full; // slabs w/ at least one free object / slabs w/ no free objects
+    uint32_t total_slabs, used_objects, total_objects; // occupancy statistics
+    struct slab_cache* next; // registry of all caches (for statistics)
+};
+
+// occupancy statistics for a single cache
+struct slab_stats {
+    const char* name;
+    size_t object_size;
+    uint32_t slabs, used_objects, total_objects, bytes; // 'bytes' = heap memory held by the cache's slabs
+};
+
+// statically define a cache for a kernel type, e.g. static struct slab_cache task_cache = SLAB_CACHE( "task", sizeof( struct task ) );
+#define SLAB_CACHE( cache_name, size ) { .name = cache_name, .object_size = size }
+
+// functions
+void slab_init( struct heap* heap );
+struct slab_cache* slab_cache_for_size( size_t size );
+void* slab_alloc( struct slab_cache* cache );
+void* slab_zalloc( struct slab_cache* cache );
+void slab_free( void* p );
+bool slab_owns( void* p );
+int slab_get_stats( struct slab_stats* stats, int max );
@@ -1,6 +1,11 @@
 #pragma once
 #include <stddef.h>
 #include <stdint.h>
+#include "config.h"
+
+// the kernel reaches physical memory through its 1:1 window in the higher half (page tables & CR3 want the physical address)
+#define PHYS_TO_VIRT( address ) ((void*)((uint32_t)(address) + PEACHOS_KERNEL_VIRTUAL_BASE))
+#define VIRT_TO_PHYS( address ) ((uint32_t)(address) - PEACHOS_KERNEL_VIRTUAL_BASE)
 
 void* memset( void* buffer, uint8_t value, size_t size );
 int memcmp( void* s1, void* s2, int count );
@@ -4,6 +4,11 @@ section .asm
 
 global paging_load_directory
 global enable_paging
+global paging_invalidate_page
+global paging_flush_global_tlb
+global paging_fault_address
+global paging_has_global_pages
+global paging_enable_global_pages
 
 paging_load_directory:
     ; C function entry (save base pointer & establish new base pointer)
@@ -18,12 +23,57 @@ paging_load_directory:
     pop ebp
     ret
 
+; void paging_invalidate_page( void* virtual_address );
+paging_invalidate_page:
+    mov eax, [esp+4]
+    invlpg [eax]
+    ret
+
+; flushes the whole TLB, global translations included (toggling CR4.PGE does that, a CR3 reload doesn't)
+; void paging_flush_global_tlb();
+paging_flush_global_tlb:
+    mov eax, cr4
+    and eax, ~0x80
+    mov cr4, eax
+    or eax, 0x80
+    mov cr4, eax
+    ret
+
+; bool paging_has_global_pages(); (cpuid leaf 1: edx bit 13 = PGE, & kernel.asm already checked cpuid exists)
+paging_has_global_pages:
+    push ebx ; cpuid clobbers ebx, which belongs to our caller
+    mov eax, 1
+    cpuid
+    xor eax, eax
+    bt edx, 13
+    setc al
+    pop ebx
+    ret
+
+; turns on global pages in CR4 (kernel translations then survive CR3 reloads)
+; void paging_enable_global_pages();
+paging_enable_global_pages:
+    mov eax, cr4
+    or eax, 0x80
+    mov cr4, eax
+    ret
+
+; void* paging_fault_address();
+paging_fault_address:
+    mov eax, cr2
+    ret
+
 enable_paging:
     ; save base pointer
     push ebp
     mov ebp, esp
 
-    ; turn on high bit in CR0
+    ; turn on page size extensions in CR4 (the kernel's window onto RAM uses 4 MB pages, & kernel.asm already checked the cpu has them)
+    mov eax, cr4
+    or eax, 0x10
+    mov cr4, eax
+
+    ; turn on high bit in CR0 (already on if kernel.asm's boot directory got us here, but harmless)
     mov eax, cr0
     or eax, 0x80000000
     mov cr0, eax
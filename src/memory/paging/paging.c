@@ -1,40 +1,97 @@
 #include "paging.h"
 #include "memory/heap/kheap.h"
+#include "config.h"
+#include "memory/frame/frame.h"
+#include "memory/e820/e820.h"
+#include "memory/memory.h"
 #include "status.h"
 #include "kernel.h"
 
 void paging_load_directory( uint32_t* directory );
 
-static uint32_t* current_directory = 0;
+void paging_invalidate_page( void* virtual_address );
+void paging_flush_global_tlb();
+bool paging_has_global_pages();
+void paging_enable_global_pages();
 
-// initialize page tables w/ the identity transformation
-struct paging_4gb_chunk* paging_new_4gb( uint8_t flags ) {
-    // allocate & initialize directory & tables
-    uint32_t* directory = kzalloc( sizeof( uint32_t ) * PAGING_TOTAL_ENTRIES_PER_TABLE );
-    for( int i = 0, offset = 0; i < PAGING_TOTAL_ENTRIES_PER_TABLE; i++, offset += PAGING_TABLE_SIZE ) {
-        uint32_t* entry = kzalloc( sizeof( uint32_t ) * PAGING_TOTAL_ENTRIES_PER_TABLE );
-        for( int b = 0; b < PAGING_TOTAL_ENTRIES_PER_TABLE; b++ ) entry[b] = (offset + (b * PAGING_PAGE_SIZE)) | flags;
-        directory[i] = (uint32_t)entry | flags | PAGING_IS_WRITEABLE;
+static struct paging_4gb_chunk* current_chunk = 0;
+
+// the kernel's address space: its page tables are linked (supervisor-only) into every other directory
+static struct paging_4gb_chunk kernel_chunk;
+
+// the kernel half is the same in every directory, so all of its translations can be global (if the cpu has PGE)
+static bool paging_global = false;
+#define PAGING_KERNEL_FLAGS ((paging_global ? PAGING_IS_GLOBAL : 0) | PAGING_IS_WRITEABLE | PAGING_IS_PRESENT)
+
+// maps physical RAM 1:1 into the kernel's half of the directory (everything above RAM stays non-present, & so does userland's half)
+// whole 4 MB slots use large pages, so only a partial slot @ the very end of RAM needs a page table
+struct paging_4gb_chunk* paging_kernel_4gb() {
+    if( kernel_chunk.directory_entry ) return &kernel_chunk;
+
+    // w/o PGE, kernel translations simply get flushed along w/ everything else on a CR3 reload
+    paging_global = paging_has_global_pages();
+    if( paging_global ) paging_enable_global_pages();
+
+    uint32_t* directory = frame_zalloc( PAGING_PAGE_SIZE );
+    if( !directory ) return NULL;
+    uint32_t end = e820_memory_end();
+    for( uint32_t i = PEACHOS_KERNEL_VIRTUAL_BASE / PAGING_TABLE_SIZE, offset = 0; i < PAGING_TOTAL_ENTRIES_PER_TABLE && offset < end; i++, offset += PAGING_TABLE_SIZE ) {
+        // whole slot: one large page
+        if( end - offset >= PAGING_TABLE_SIZE ) {
+            directory[i] = offset | PAGING_IS_LARGE | PAGING_KERNEL_FLAGS;
+            continue;
+        }
+
+        // partial slot: page table that stops @ the end of RAM
+        uint32_t* entry = frame_zalloc( PAGING_PAGE_SIZE );
+        if( !entry ) return NULL;
+        for( uint32_t b = 0, page = offset; b < PAGING_TOTAL_ENTRIES_PER_TABLE && page < end; b++, page += PAGING_PAGE_SIZE )
+            entry[b] = page | PAGING_KERNEL_FLAGS;
+        directory[i] = VIRT_TO_PHYS( entry ) | PAGING_TABLE_PRIVATE | PAGING_IS_WRITEABLE | PAGING_IS_PRESENT;
     }
+    kernel_chunk.directory_entry = directory;
+    return &kernel_chunk;
+}
+
+// creates a new address space w/ the kernel mapped in (kernel pages are supervisor-only, so userland starts out seeing nothing)
+// note: no page tables are allocated here, they're shared w/ the kernel until the 1st paging_set into their slot
+struct paging_4gb_chunk* paging_new_4gb() {
+    // allocate the directory as a copy of the kernel's (which doesn't own the kernel's tables)
+    struct paging_4gb_chunk* kernel = paging_kernel_4gb();
+    if( !kernel ) return NULL;
+    uint32_t* directory = frame_alloc( PAGING_PAGE_SIZE );
+    if( !directory ) return NULL;
+    for( int i = 0; i < PAGING_TOTAL_ENTRIES_PER_TABLE; i++ ) directory[i] = kernel->directory_entry[i] & ~PAGING_TABLE_PRIVATE;
 
     // wrap directory in the paging_4gb_chunk struct
     struct paging_4gb_chunk* chunk_4gb = kzalloc( sizeof( struct paging_4gb_chunk ) );
+    if( !chunk_4gb ) { frame_free( directory ); return NULL; }
     chunk_4gb->directory_entry = directory;
     return chunk_4gb;
 }
 
+// the kernel is mapped into every directory, so there's nothing to do if we're already on this one
 void paging_switch( struct paging_4gb_chunk* directory ) {
-    paging_load_directory( directory->directory_entry );
-    current_directory = directory->directory_entry;
+    if( current_chunk == directory ) return;
+    paging_load_directory( (uint32_t*)VIRT_TO_PHYS( directory->directory_entry ) );
+    current_chunk = directory;
 }
 
+struct paging_4gb_chunk* paging_current() { return current_chunk; }
+
+// only the page tables this directory owns are freed (shared tables belong to the kernel)
 void paging_free_4gb( struct paging_4gb_chunk* chunk ) {
+    if( &kernel_chunk == chunk ) panic( "paging_free_4gb: cannot free the kernel's address space\n" );
+
+    // can't pull the directory out from underneath ourselves
+    if( current_chunk == chunk ) paging_switch( &kernel_chunk );
     for( int i = 0; i < PAGING_TOTAL_ENTRIES_PER_TABLE; i++ ) {
         uint32_t entry = chunk->directory_entry[i];
-        uint32_t* table = (uint32_t*)(entry & 0xFFFFF000); // grab just the pointer part of the directory entry
-        kfree( table );
+        if( !(PAGING_TABLE_PRIVATE & entry) ) continue;
+        uint32_t* table = PHYS_TO_VIRT( entry & 0xFFFFF000 ); // grab just the pointer part of the directory entry
+        frame_free( table );
     }
-    kfree( chunk->directory_entry );
+    frame_free( chunk->directory_entry );
     kfree( chunk );
 }
 
@@ -61,6 +118,56 @@ void* paging_align_floor( void* address ) { // aligns address by rounding down
     return (void*)addr;
 }
 
+// returns the page table for a directory slot, allocating it on first use
+// (a slot that still points @ a shared kernel table gets its own copy, so the kernel's tables are never modified)
+// (a large page gets split into 4 KB pages w/ the same permissions, since we're about to change one of them)
+static uint32_t* paging_private_table( uint32_t* directory, uint32_t directory_index ) {
+    // already have our own table
+    uint32_t entry = directory[directory_index];
+    if( (PAGING_TABLE_PRIVATE & entry) && !(PAGING_IS_LARGE & entry) ) return PHYS_TO_VIRT( entry & 0xFFFFF000 );
+
+    // allocate a table, starting out as a copy of the shared table, a split large page, or blank
+    uint32_t* table = frame_alloc( PAGING_PAGE_SIZE );
+    if( !table ) return NULL;
+    if( !(PAGING_IS_PRESENT & entry) ) memset( table, 0, PAGING_PAGE_SIZE );
+    else if( PAGING_IS_LARGE & entry ) {
+        uint32_t base = entry & 0xFFC00000, flags = entry & (PAGING_IS_GLOBAL | PAGING_CACHE_DISABLED | PAGING_WRITE_THROUGH | PAGING_ACCESS_FROM_ALL | PAGING_IS_WRITEABLE | PAGING_IS_PRESENT);
+        for( int b = 0; b < PAGING_TOTAL_ENTRIES_PER_TABLE; b++ ) table[b] = (base + (b * PAGING_PAGE_SIZE)) | flags;
+    }
+    else memcpy( table, PHYS_TO_VIRT( entry & 0xFFFFF000 ), PAGING_PAGE_SIZE );
+
+    // access rights are decided per page (copied kernel pages stay supervisor-only), so the directory entry allows everything
+    directory[directory_index] = VIRT_TO_PHYS( table ) | PAGING_TABLE_PRIVATE | PAGING_IS_WRITEABLE | PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL;
+    return table;
+}
+
+// writes a page table entry w/o touching the TLB ('global' is set if a global translation got replaced)
+static int paging_set_entry( uint32_t* directory, void* virtual_address, uint32_t value, bool* global ) {
+    // get directory_index & table_index
+    uint32_t directory_index = 0, table_index = 0;
+    int res = paging_get_indexes( virtual_address, &directory_index, &table_index );
+    if( res < 0 ) return res;
+
+    // get (or lazily create) a page table this directory owns
+    uint32_t* table = paging_private_table( directory, directory_index );
+    if( !table ) return -ENOMEM;
+    if( PAGING_IS_GLOBAL & table[table_index] ) *global = true;
+    table[table_index] = value;
+    return 0;
+}
+
+// drops stale translations for 'count' pages after their entries changed
+// (only needed if the directory is live, or if a global translation was replaced, since those survive CR3 reloads)
+static void paging_flush_range( uint32_t* directory, void* virt, int count, bool global ) {
+    if( !global && !(current_chunk && directory == current_chunk->directory_entry) ) return;
+    if( count <= PAGING_INVLPG_THRESHOLD ) {
+        for( int i = 0; i < count; i++ ) paging_invalidate_page( virt + i * PAGING_PAGE_SIZE );
+        return;
+    }
+    if( global && paging_global ) paging_flush_global_tlb(); // (toggling CR4.PGE would fault w/o PGE)
+    else paging_load_directory( (uint32_t*)VIRT_TO_PHYS( directory ) );
+}
+
 int paging_map( struct paging_4gb_chunk* directory, void* virt, void* phys, int flags ) {
     // check alignment
     if( (uint32_t)virt % PAGING_PAGE_SIZE || (uint32_t)phys % PAGING_PAGE_SIZE ) return -EINVARG;
@@ -69,14 +176,74 @@ int paging_map( struct paging_4gb_chunk* directory, void* virt, void* phys, int
     return paging_set( directory->directory_entry, virt, (uint32_t)phys | flags );
 }
 
+// the page table entry a directory entry implies for 'table_index' (large pages have no table, so make it up)
+static uint32_t paging_table_entry( uint32_t directory_entry, uint32_t table_index ) {
+    if( !(PAGING_IS_PRESENT & directory_entry) ) return 0;
+    if( PAGING_IS_LARGE & directory_entry )
+        return ((directory_entry & 0xFFC00000) + (table_index * PAGING_PAGE_SIZE)) | (directory_entry & (PAGING_IS_GLOBAL | 0x1F));
+    return ((uint32_t*)PHYS_TO_VIRT( directory_entry & 0xFFFFF000 ))[table_index];
+}
+
+// the range engine: each page table is looked up (or created) once, then its run of entries is filled in a tight loop
+// (phys = NULL & a kernel 'source' directory means: copy the source's entries, i.e. hand the pages back to the kernel)
+static int paging_fill_range( struct paging_4gb_chunk* chunk, uint32_t virt, uint32_t phys, int count, int flags, uint32_t* source, PAGING_ENTRY_FUNCTION released ) {
+    uint32_t* directory = chunk->directory_entry;
+    uint32_t directory_index = virt / PAGING_TABLE_SIZE, table_index = (virt % PAGING_TABLE_SIZE) / PAGING_PAGE_SIZE;
+    bool global = false;
+    int res = 0, done = 0;
+    while( done < count ) {
+        // the run of entries that lives in this page table
+        int run = PAGING_TOTAL_ENTRIES_PER_TABLE - table_index;
+        if( run > count - done ) run = count - done;
+
+        // unmapping a slot this directory never wrote to is a no-op (it's all still the kernel's)
+        uint32_t* table = NULL;
+        if( !source || &kernel_chunk == chunk || (PAGING_TABLE_PRIVATE & directory[directory_index]) ) {
+            if( !(table = paging_private_table( directory, directory_index )) ) { res = -ENOMEM; break; }
+        }
+
+        // fill it in
+        for( int i = 0; table && i < run; i++ ) {
+            uint32_t old = table[table_index + i];
+            if( PAGING_IS_GLOBAL & old ) global = true;
+            if( released ) released( old );
+            if( !source ) table[table_index + i] = (phys + i * PAGING_PAGE_SIZE) | flags;
+            else table[table_index + i] = &kernel_chunk == chunk ? 0 : paging_table_entry( source[directory_index], table_index + i );
+        }
+
+        // next page table
+        phys+= run * PAGING_PAGE_SIZE;
+        done+= run;
+        directory_index++;
+        table_index = 0;
+    }
+    paging_flush_range( directory, (void*)virt, done, global );
+    return res;
+}
+
 int paging_map_range( struct paging_4gb_chunk* directory, void* virt, void* phys, int count, int flags ) {
-     for( int i = 0; i < count; i++ ) {
-         int res = paging_map( directory, virt, phys, flags );
-         if( res < 0 ) return res;
-         virt += PAGING_PAGE_SIZE;
-         phys += PAGING_PAGE_SIZE;
-     }
-     return 0;
+    if( (uint32_t)virt % PAGING_PAGE_SIZE || (uint32_t)phys % PAGING_PAGE_SIZE || count < 0 ) return -EINVARG;
+    return paging_fill_range( directory, (uint32_t)virt, (uint32_t)phys, count, flags, NULL, NULL );
+}
+
+// unmapping puts back whatever the kernel has there (i.e. nothing, below the kernel's half)
+int paging_unmap_range( struct paging_4gb_chunk* directory, void* virt, int count, PAGING_ENTRY_FUNCTION released ) {
+    if( (uint32_t)virt % PAGING_PAGE_SIZE || count < 0 ) return -EINVARG;
+    return paging_fill_range( directory, (uint32_t)virt, 0, count, 0, kernel_chunk.directory_entry, released );
+}
+
+// calls 'visit' w/ each entry in the range that this directory has mapped itself
+void paging_walk_range( struct paging_4gb_chunk* chunk, void* virt, int count, PAGING_ENTRY_FUNCTION visit ) {
+    uint32_t* directory = chunk->directory_entry;
+    uint32_t directory_index = (uint32_t)virt / PAGING_TABLE_SIZE, table_index = ((uint32_t)virt % PAGING_TABLE_SIZE) / PAGING_PAGE_SIZE;
+    for( int done = 0, run; done < count; done+= run, directory_index++, table_index = 0 ) {
+        run = PAGING_TOTAL_ENTRIES_PER_TABLE - table_index;
+        if( run > count - done ) run = count - done;
+        uint32_t entry = directory[directory_index];
+        if( !(PAGING_TABLE_PRIVATE & entry) || (PAGING_IS_LARGE & entry) ) continue;
+        uint32_t* table = PHYS_TO_VIRT( entry & 0xFFFFF000 );
+        for( int i = 0; i < run; i++ ) visit( table[table_index + i] );
+    }
 }
 
 int paging_map_to( struct paging_4gb_chunk* directory, void* virt, void* phys, void* phys_end, int flags ) {
@@ -96,16 +263,12 @@ int paging_set( uint32_t* directory, void* virtual_address, uint32_t value ) {
     // sanity check args
     if( !paging_is_aligned( virtual_address ) ) return -EINVARG;
 
-    // get directory_index & table_index
-    uint32_t directory_index = 0, table_index = 0;
-    int res = paging_get_indexes( virtual_address, &directory_index, &table_index );
+    // write the entry & drop its stale translation
+    bool global = false;
+    int res = paging_set_entry( directory, virtual_address, value, &global );
     if( res < 0 ) return res;
-
-    // get directory entry & table entry
-    uint32_t entry = directory[directory_index];
-    uint32_t* table = (uint32_t*)(entry & 0xFFFFF000); // get just the address part of the entry (top 20 bits)
-    table[table_index] = value;
-    return res;
+    paging_flush_range( directory, virtual_address, 1, global );
+    return 0;
 }
 
 uint32_t paging_get( uint32_t* directory, void* virt ) {
@@ -114,11 +277,8 @@ uint32_t paging_get( uint32_t* directory, void* virt ) {
     if( paging_get_indexes( virt, &directory_index, &table_index ) < 0 )
         panic( "cannot get page table index for unaligned address\n" );
 
-    // get entry and get table pointer
-    uint32_t entry = directory[directory_index], *table = (uint32_t*)(entry & 0xFFFFF000);
-
-    // lookup address in table
-    return table[table_index];
+    // lookup address in table (unmapped slots have no table at all, & large pages make one up)
+    return paging_table_entry( directory[directory_index], table_index );
 }
 
 void* paging_get_physical_address( uint32_t* directory, void* virt ) {
@@ -7,25 +7,41 @@
 #include <stdbool.h>
 
 // page table entry bits (where entry = 32-bit)
+#define PAGING_IS_GLOBAL     0b0100000000 // translation survives CR3 reloads (needs CR4.PGE), only for mappings that are the same in every directory
 #define PAGING_CACHE_DISABLED  0b00010000
 #define PAGING_WRITE_THROUGH   0b00001000
 #define PAGING_ACCESS_FROM_ALL 0b00000100 // allows access from all privilege levels
 #define PAGING_IS_WRITEABLE     0b00000010
 #define PAGING_IS_PRESENT      0b00000001
 
+// directory entry bits
+#define PAGING_IS_LARGE      0b0010000000 // entry maps a 4 MB page directly (needs CR4.PSE), instead of pointing @ a page table
+// (available-to-software bits, ignored by the CPU)
+#define PAGING_TABLE_PRIVATE 0b1000000000 // page table is owned by this directory (not shared), so it's freed w/ it
+
+// page table entry bits (available-to-software bits, ignored by the CPU)
+#define PAGING_PAGE_OWNED 0b10000000000 // page's frame was allocated for this address space, so it's freed w/ it
+#define PAGING_PAGE_COW    0b01000000000 // page is writeable, but its frame is (or was) shared, so it's copied on the 1st write
+
+#define PAGING_INVLPG_THRESHOLD 32 // above this many pages, 1 full TLB flush is cheaper than invalidating page by page
+
 #define PAGING_TOTAL_ENTRIES_PER_TABLE 1024
 #define PAGING_PAGE_SIZE 4096
 #define PAGING_TABLE_SIZE 4194304 // PAGING_TOTAL_ENTRIES_PER_TABLE * PAGING_PAGE_SIZE
 
 // types
 struct paging_4gb_chunk { uint32_t* directory_entry; };
+typedef void(*PAGING_ENTRY_FUNCTION)( uint32_t entry ); // visits page table entries of a range
 
 // functions
 uint32_t* paging_4gb_chunk_get_directory( struct paging_4gb_chunk* chunk );
-struct paging_4gb_chunk* paging_new_4gb( uint8_t flags );
+struct paging_4gb_chunk* paging_kernel_4gb(); // the kernel's address space (built on 1st call)
+struct paging_4gb_chunk* paging_new_4gb(); // a user address space (w/ the kernel's tables linked in)
 void paging_free_4gb( struct paging_4gb_chunk* chunk );
 void paging_switch( struct paging_4gb_chunk* directory );
+struct paging_4gb_chunk* paging_current();
 void enable_paging(); // warning: must create page tables & switch to a given directory BEFORE enabling paging (or else, kernel panic)
+// (kernel.asm turns paging on itself, to get into the higher half, so this is what adds global pages afterwards)
 
 // checks is a 'address' is aligned to page boundary
 bool paging_is_aligned( void* address );
@@ -36,6 +52,9 @@ int paging_set( uint32_t* directory, void* virtual_address, uint32_t value );
 int paging_map( struct paging_4gb_chunk* directory, void* virt, void* phys, int flags );
 int paging_map_range( struct paging_4gb_chunk* directory, void* virt, void* phys, int count, int flags );
 int paging_map_to( struct paging_4gb_chunk* directory, void* virt, void* phys, void* phys_end, int flags );
+int paging_unmap_range( struct paging_4gb_chunk* directory, void* virt, int count, PAGING_ENTRY_FUNCTION released ); // hands the pages back to the kernel's mapping ('released' sees the old entries)
+void paging_walk_range( struct paging_4gb_chunk* directory, void* virt, int count, PAGING_ENTRY_FUNCTION visit );
 void* paging_align_ceiling( void* address );
 void* paging_align_floor( void* address );
 void* paging_get_physical_address( uint32_t* directory, void* virt );
+void* paging_fault_address(); // address that caused the last page fault (CR2)
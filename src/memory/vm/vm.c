@@ -0,0 +1,262 @@
+#include "vm.h"
+#include "status.h"
+#include "config.h"
+#include "memory/memory.h"
+#include "memory/paging/paging.h"
+#include "memory/frame/frame.h"
+#include "memory/heap/slab.h"
+
+static struct slab_cache vm_area_cache = SLAB_CACHE( "vm_area", sizeof( struct vm_area ) );
+
+void vm_init( struct vm_space* vm, struct paging_4gb_chunk* directory ) {
+    vm->directory = directory;
+    vm->areas = NULL;
+}
+
+// a page belongs to the process once it's a present user page
+static bool vm_is_populated( uint32_t entry ) { return (PAGING_IS_PRESENT & entry) && (PAGING_ACCESS_FROM_ALL & entry); }
+
+static void vm_release_entry( uint32_t entry ) {
+    if( vm_is_populated( entry ) && (PAGING_PAGE_OWNED & entry) ) frame_free( PHYS_TO_VIRT( entry & 0xFFFFF000 ) );
+}
+
+// frees the frames an area allocated, & optionally hands its pages back to the kernel's mapping
+static void vm_release_pages( struct vm_space* vm, struct vm_area* area, bool unmap ) {
+    int count = (area->end - area->start) / PAGING_PAGE_SIZE;
+    if( unmap ) paging_unmap_range( vm->directory, (void*)area->start, count, vm_release_entry );
+    else paging_walk_range( vm->directory, (void*)area->start, count, vm_release_entry );
+}
+
+void vm_destroy( struct vm_space* vm ) {
+    // the page directory itself goes away w/ the task, so there's no need to unmap anything
+    for( struct vm_area *area = vm->areas, *next; area; area = next ) {
+        next = area->next;
+        vm_release_pages( vm, area, false );
+        slab_free( area );
+    }
+    vm->areas = NULL;
+}
+
+struct vm_area* vm_find( struct vm_space* vm, uint32_t address ) {
+    for( struct vm_area* area = vm->areas; area && area->start <= address; area = area->next )
+        if( address < area->end ) return area;
+    return NULL;
+}
+
+// inserts an area in sorted order (areas may not overlap)
+static int vm_insert( struct vm_space* vm, struct vm_area* area ) {
+    if( area->start % PAGING_PAGE_SIZE || area->end % PAGING_PAGE_SIZE || area->start >= area->end ) return -EINVARG;
+    if( area->end > PEACHOS_USER_SPACE_END ) return -EINVARG; // the kernel's half is off limits
+    struct vm_area** link = &vm->areas;
+    while( *link && (*link)->end <= area->start ) link = &(*link)->next;
+    if( *link && (*link)->start < area->end ) return -EISTKN;
+    area->next = *link;
+    *link = area;
+    return 0;
+}
+
+static int vm_add( struct vm_space* vm, struct vm_area* area ) {
+    struct vm_area* copy = slab_alloc( &vm_area_cache );
+    if( !copy ) return -ENOMEM;
+    *copy = *area;
+    int res = vm_insert( vm, copy );
+    if( res < 0 ) slab_free( copy );
+    return res;
+}
+
+int vm_map_anonymous( struct vm_space* vm, uint32_t start, uint32_t end, int flags ) {
+    struct vm_area area = { .start = start, .end = end, .type = VM_AREA_ANONYMOUS, .flags = flags };
+    return vm_add( vm, &area );
+}
+
+int vm_map_file( struct vm_space* vm, uint32_t start, uint32_t end, int flags, void* data, uint32_t data_start, uint32_t data_end ) {
+    struct vm_area area = { .start = start, .end = end, .type = VM_AREA_FILE, .flags = flags, .data = data, .data_start = data_start, .data_end = data_end };
+    return vm_add( vm, &area );
+}
+
+// the stack starts out as a single page just below 'top'
+int vm_map_stack( struct vm_space* vm, uint32_t top, uint32_t limit, int flags ) {
+    struct vm_area area = { .start = top - PAGING_PAGE_SIZE, .end = top, .type = VM_AREA_STACK, .flags = flags, .limit = limit };
+    return vm_add( vm, &area );
+}
+
+int vm_unmap( struct vm_space* vm, uint32_t start ) {
+    // find the area that starts @ 'start'
+    struct vm_area** link = &vm->areas;
+    while( *link && (*link)->start != start ) link = &(*link)->next;
+    struct vm_area* area = *link;
+    if( !area ) return -EINVARG;
+
+    // unlink it & give back its memory
+    *link = area->next;
+    vm_release_pages( vm, area, true );
+    slab_free( area );
+    return 0;
+}
+
+// first fit search for 'size' bytes of unused address space in [low, high)
+uint32_t vm_find_free( struct vm_space* vm, uint32_t low, uint32_t high, uint32_t size ) {
+    size = (uint32_t)paging_align_ceiling( (void*)size );
+    uint32_t candidate = low;
+    for( struct vm_area* area = vm->areas; area && area->start < high; area = area->next ) {
+        if( area->end <= candidate ) continue;
+        if( area->start >= candidate + size ) break;
+        candidate = area->end;
+    }
+    return candidate + size <= high && candidate + size > candidate ? candidate : 0;
+}
+
+// stacks grow down into the gap below them (as long as no other area is in the way)
+static struct vm_area* vm_grow_stack( struct vm_space* vm, uint32_t address ) {
+    struct vm_area *below = NULL;
+    for( struct vm_area* area = vm->areas; area; below = area, area = area->next ) {
+        if( VM_AREA_STACK != area->type || address >= area->start || address < area->limit ) continue;
+        uint32_t page = (uint32_t)paging_align_floor( (void*)address );
+        if( below && below->end > page ) return NULL;
+        area->start = page;
+        return area;
+    }
+    return NULL;
+}
+
+// gives a page of an area its own frame
+static int vm_populate( struct vm_space* vm, struct vm_area* area, uint32_t page ) {
+    void* frame = frame_zalloc( PAGING_PAGE_SIZE );
+    if( !frame ) return -ENOMEM;
+
+    // file-backed pages get whatever part of the image overlaps them (the rest stays zero)
+    if( VM_AREA_FILE == area->type ) {
+        uint32_t from = page > area->data_start ? page : area->data_start,
+                 to = page + PAGING_PAGE_SIZE < area->data_end ? page + PAGING_PAGE_SIZE : area->data_end;
+        if( from < to ) memcpy( frame + (from - page), area->data + (from - area->data_start), to - from );
+    }
+
+    // map it
+    int res = paging_map( vm->directory, (void*)page, (void*)VIRT_TO_PHYS( frame ), area->flags | PAGING_PAGE_OWNED );
+    if( res < 0 ) frame_free( frame );
+    return res;
+}
+
+// 1st write to a shared page: take a private copy (or just take the frame over if nobody else is left sharing it)
+static int vm_copy_on_write( struct vm_space* vm, uint32_t page, uint32_t entry ) {
+    void* frame = PHYS_TO_VIRT( entry & 0xFFFFF000 );
+    int flags = ((entry & 0xFFF) & ~PAGING_PAGE_COW) | PAGING_IS_WRITEABLE;
+    if( !frame_is_shared( frame ) ) return paging_map( vm->directory, (void*)page, (void*)(entry & 0xFFFFF000), flags );
+
+    // copy the page
+    void* copy = frame_alloc( PAGING_PAGE_SIZE );
+    if( !copy ) return -ENOMEM;
+    memcpy( copy, frame, PAGING_PAGE_SIZE );
+    int res = paging_map( vm->directory, (void*)page, (void*)VIRT_TO_PHYS( copy ), flags );
+    if( res < 0 ) { frame_free( copy ); return res; }
+
+    // & drop our reference to the shared frame
+    frame_free( frame );
+    return 0;
+}
+
+int vm_handle_fault( struct vm_space* vm, void* address, uint32_t error_code ) {
+    // find the area (or grow the stack into it)
+    uint32_t addr = (uint32_t)address, page = (uint32_t)paging_align_floor( address );
+    struct vm_area* area = vm_find( vm, addr );
+    if( !area ) area = vm_grow_stack( vm, addr );
+    if( !area ) return -EFAULT;
+
+    // already populated means it's either a copy-on-write page, or a real protection violation
+    uint32_t entry = paging_get( paging_4gb_chunk_get_directory( vm->directory ), (void*)page );
+    if( vm_is_populated( entry ) ) {
+        if( (VM_FAULT_WRITE & error_code) && (PAGING_PAGE_COW & entry) ) return vm_copy_on_write( vm, page, entry );
+        return -EFAULT;
+    }
+    if( (VM_FAULT_WRITE & error_code) && !(PAGING_IS_WRITEABLE & area->flags) ) return -EFAULT;
+    return vm_populate( vm, area, page );
+}
+
+int vm_fork( struct vm_space* child, struct vm_space* parent ) {
+    uint32_t *parent_directory = paging_4gb_chunk_get_directory( parent->directory ),
+             *child_directory = paging_4gb_chunk_get_directory( child->directory );
+    for( struct vm_area* area = parent->areas; area; area = area->next ) {
+        // same areas...
+        int res = vm_add( child, area );
+        if( res < 0 ) return res;
+
+        // ...& the same pages (writeable ones become read-only in both, until one of them writes)
+        for( uint32_t page = area->start; page < area->end; page+= PAGING_PAGE_SIZE ) {
+            uint32_t entry = paging_get( parent_directory, (void*)page );
+            if( !vm_is_populated( entry ) ) continue;
+            if( (PAGING_PAGE_OWNED & entry) && (PAGING_IS_WRITEABLE & entry) ) {
+                entry = (entry & ~PAGING_IS_WRITEABLE) | PAGING_PAGE_COW;
+                if( (res = paging_set( parent_directory, (void*)page, entry )) < 0 ) return res;
+            }
+            if( (res = paging_set( child_directory, (void*)page, entry )) < 0 ) return res;
+            if( PAGING_PAGE_OWNED & entry ) frame_share( PHYS_TO_VIRT( entry & 0xFFFFF000 ) );
+        }
+    }
+    return 0;
+}
+
+// returns a kernel pointer to the byte @ 'address' in the process' memory (faulting it in if needed)
+void* vm_translate( struct vm_space* vm, void* address, bool write ) {
+    uint32_t* directory = paging_4gb_chunk_get_directory( vm->directory );
+    void* page = paging_align_floor( address );
+    uint32_t entry = paging_get( directory, page );
+    if( !vm_is_populated( entry ) || (write && !(PAGING_IS_WRITEABLE & entry)) ) {
+        if( vm_handle_fault( vm, address, VM_FAULT_USER | (write ? VM_FAULT_WRITE : 0) ) < 0 ) return NULL;
+        entry = paging_get( directory, page );
+    }
+    if( write && !(PAGING_IS_WRITEABLE & entry) ) return NULL;
+    return PHYS_TO_VIRT( (entry & 0xFFFFF000) + (address - page) );
+}
+
+// user pointers have to stay below the kernel's half (& not wrap around)
+static bool vm_is_user_range( const void* virt, size_t size ) {
+    uint32_t start = (uint32_t)virt, end = start + size;
+    return end >= start && end <= PEACHOS_USER_SPACE_END;
+}
+
+int vm_copy_to( struct vm_space* vm, void* virt, const void* src, size_t size ) {
+    if( !vm_is_user_range( virt, size ) ) return -EFAULT;
+    while( size > 0 ) {
+        // copy up to the end of the page
+        size_t chunk = PAGING_PAGE_SIZE - ((uint32_t)virt % PAGING_PAGE_SIZE);
+        if( chunk > size ) chunk = size;
+        void* dst = vm_translate( vm, virt, true );
+        if( !dst ) return -EFAULT;
+        memcpy( dst, (void*)src, chunk );
+        virt+= chunk;
+        src+= chunk;
+        size-= chunk;
+    }
+    return 0;
+}
+
+int vm_copy_from( struct vm_space* vm, void* dst, const void* virt, size_t size ) {
+    if( !vm_is_user_range( virt, size ) ) return -EFAULT;
+    while( size > 0 ) {
+        // copy up to the end of the page
+        size_t chunk = PAGING_PAGE_SIZE - ((uint32_t)virt % PAGING_PAGE_SIZE);
+        if( chunk > size ) chunk = size;
+        void* src = vm_translate( vm, (void*)virt, false );
+        if( !src ) return -EFAULT;
+        memcpy( dst, src, chunk );
+        virt+= chunk;
+        dst+= chunk;
+        size-= chunk;
+    }
+    return 0;
+}
+
+int vm_strncpy_from( struct vm_space* vm, char* dst, const char* virt, int max ) {
+    if( max <= 0 ) return -EINVARG;
+    const char* in = NULL;
+    int i;
+    for( i = 0; i < max - 1; i++ ) {
+        // translate again whenever we cross into a new page
+        if( !in || 0 == (uint32_t)(virt + i) % PAGING_PAGE_SIZE ) {
+            if( !vm_is_user_range( virt + i, 1 ) || !(in = vm_translate( vm, (void*)(virt + i), false )) ) return -EFAULT;
+        }
+        if( !(dst[i] = *in++) ) return i;
+    }
+    dst[i] = 0;
+    return i;
+}
@@ -0,0 +1,59 @@
+// https://wiki.osdev.org/Paging#Page_Faults
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+struct paging_4gb_chunk;
+
+// kinds of virtual memory area
+#define VM_AREA_ANONYMOUS 0 // zero-filled on first touch
+#define VM_AREA_FILE 1 // filled from an in-memory image (e.g. an ELF segment) on first touch, zero past the image
+#define VM_AREA_STACK 2 // zero-filled, & grows downwards (to 'limit') when touched just below its start
+
+// page fault error code bits (pushed by the CPU)
+#define VM_FAULT_PRESENT 0b001 // page was present (so it's a protection violation, rather than a missing page)
+#define VM_FAULT_WRITE   0b010 // fault was caused by a write
+#define VM_FAULT_USER    0b100 // fault happened in user mode
+
+// a range of a process' address space, whose pages are allocated when they're first touched
+struct vm_area {
+    uint32_t start, end; // page aligned [start, end)
+    uint8_t type;
+    int flags; // PAGING_* flags for the area's pages
+    void* data; // file-backed: bytes for [data_start, data_end)
+    uint32_t data_start, data_end;
+    uint32_t limit; // stack: lowest address the area can grow down to
+    struct vm_area* next; // sorted by start address
+};
+
+// a process' address space
+struct vm_space {
+    struct paging_4gb_chunk* directory;
+    struct vm_area* areas;
+};
+
+// setup & teardown (destroy frees every frame the areas allocated)
+void vm_init( struct vm_space* vm, struct paging_4gb_chunk* directory );
+void vm_destroy( struct vm_space* vm );
+
+// reserve address ranges (no memory is allocated until the pages are touched)
+int vm_map_anonymous( struct vm_space* vm, uint32_t start, uint32_t end, int flags );
+int vm_map_file( struct vm_space* vm, uint32_t start, uint32_t end, int flags, void* data, uint32_t data_start, uint32_t data_end );
+int vm_map_stack( struct vm_space* vm, uint32_t top, uint32_t limit, int flags );
+int vm_unmap( struct vm_space* vm, uint32_t start );
+struct vm_area* vm_find( struct vm_space* vm, uint32_t address );
+uint32_t vm_find_free( struct vm_space* vm, uint32_t low, uint32_t high, uint32_t size ); // returns 0 if there's no room
+
+// resolves a fault @ 'address' (returns < 0 if the access isn't allowed, and the process should be killed)
+int vm_handle_fault( struct vm_space* vm, void* address, uint32_t error_code );
+
+// copies 'parent' into 'child' (an empty space), sharing the frames copy-on-write
+int vm_fork( struct vm_space* child, struct vm_space* parent );
+
+// kernel access to a process' memory (pages get populated as needed, so these work on any address space)
+void* vm_translate( struct vm_space* vm, void* address, bool write );
+// (user pointers are checked against the kernel's half, & a missing or forbidden page gives -EFAULT)
+int vm_copy_to( struct vm_space* vm, void* virt, const void* src, size_t size );
+int vm_copy_from( struct vm_space* vm, void* dst, const void* virt, size_t size );
+int vm_strncpy_from( struct vm_space* vm, char* dst, const char* virt, int max ); // returns the string's length (truncated to fit 'max', w/ the terminator)
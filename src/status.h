@@ -10,3 +10,6 @@
 #define EUNIMP 7 // not implemented
 #define EISTKN 8 // is taken
 #define EINFORMAT 9 // invalid format
+#define EFAULT 10 // bad address
+#define EFBIG 11 // file too large
+#define ENOTREADY 12 // not initialized yet
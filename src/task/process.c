@@ -9,10 +9,14 @@
 #include "kernel.h"
 #include "memory/paging/paging.h"
 #include "loader/formats/elfloader.h"
+#include "memory/heap/slab.h"
+#include "memory/frame/frame.h"
+#include "shared.h"
 
 // process storage
 struct process* focused_process = 0;
 static struct process* processes[PEACHOS_MAX_PROCESSES] = {};
+static struct slab_cache process_cache = SLAB_CACHE( "process", sizeof( struct process ) );
 
 static void process_init( struct process* process ) { memset( process, 0, sizeof( struct process ) ); }
 
@@ -23,49 +27,17 @@ struct process* process_get( int process_id ) {
     return processes[process_id];
 }
 
-static int process_find_free_allocation_index( struct process* process ) {
-    for( int i = 0; i < PEACHOS_MAX_PROGRAM_ALLOCATIONS; i++ )
-        if( !process->allocations[i].ptr ) return i;
-    return -ENOMEM;
-}
-
+// reserves address space in the process' heap window (the pages get allocated when they're first touched)
 void* process_malloc( struct process* process, size_t size ) {
-    // find an allocation slot
-    int index = process_find_free_allocation_index( process );
-    if( index < 0 ) return NULL;
-    
-    // allocate on kernel heap (note that it's already aligned to 4096 bytes)
-    void* ptr = kzalloc( size );
-    if( !ptr ) return NULL;
-
-    // map the userspace memory to the kernel's allocation using physical->physical mapping
-    if( paging_map_to(
-            process->task->paging_directory, ptr, ptr, paging_align_ceiling( ptr + size ),
-            PAGING_IS_WRITEABLE | PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL ) < 0 ) {
-        kfree( ptr ); // if mapping fails, make sure we free the allocation to avoid a memory leak
-        return NULL;
-    }
-
-    // finally, save the pointer in the process' allocation table, so we can deallocate it when process terminates
-    process->allocations[index].ptr = ptr;
-    process->allocations[index].size = size;
-    return ptr;
+    if( 0 == size ) return NULL;
+    uint32_t start = vm_find_free( &process->vm, PEACHOS_PROGRAM_HEAP_VIRTUAL_ADDRESS, PEACHOS_PROGRAM_HEAP_VIRTUAL_ADDRESS_END, size );
+    if( !start ) return NULL;
+    uint32_t end = (uint32_t)paging_align_ceiling( (void*)(start + size) );
+    if( vm_map_anonymous( &process->vm, start, end, PAGING_IS_WRITEABLE | PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL ) < 0 ) return NULL;
+    return (void*)start;
 }
 
-static struct process_allocation* process_get_allocation_by_addr( struct process* process, void* addr ) {
-    for( int i = 0; i < PEACHOS_MAX_PROGRAM_ALLOCATIONS; i++ )
-        if( process->allocations[i].ptr == addr ) return &process->allocations[i];
-    return NULL;
-}
-
-// TODO: later on, we could optimize this by just doing a kfree instead of a process_free, and not worrying about unmapping the page tables
-int process_terminate_allocations( struct process* process ) {
-    for( int i = 0; i < PEACHOS_MAX_PROGRAM_ALLOCATIONS; i++ )
-        process_free( process, process->allocations[i].ptr );
-    return 0;
-}
-
-int process_free_binary_data( struct process* process ) { kfree( process->ptr ); return 0; }
+int process_free_binary_data( struct process* process ) { frame_free_pages( process->ptr, process->size ); return 0; }
 int process_free_elf_data( struct process* process ) { elf_close( process->elf_file ); return 0; }
 
 int process_free_program_data( struct process* process ) {
@@ -90,16 +62,14 @@ static void process_unlink( struct process* process ) {
 
 // immediately kills a process
 int process_terminate( struct process* process ) {
-    // free the process' heap allocations
-    int res = process_terminate_allocations( process );
-    if( res < 0 ) return res;
+    // free every page the process touched (program image, stack & heap)
+    vm_destroy( &process->vm );
+    shared_page_free( process );
 
     // free the program data
+    int res;
     if( (res = process_free_program_data( process )) < 0 ) return res;
 
-    // free stack memory
-    kfree( process->stack );
-
     // free task memory
     task_free( process->task );
 
@@ -136,9 +106,9 @@ int process_inject_arguments( struct process* process, struct command_argument*
         char* argument_str = process_malloc( process, sizeof( current->argument ) );
         if( !argument_str ) { res = -ENOMEM; goto out; }
 
-        // copy string into it (works b/c we've mapped the pages the same in kernel space)
-        strncpy( argument_str, current->argument, sizeof( current->argument ) );
-        argv[i] = argument_str;
+        // copy string into it & point argv @ it (the process isn't running, so write into its address space via its page tables)
+        if( (res = vm_copy_to( &process->vm, argument_str, current->argument, sizeof( current->argument ) )) < 0 ) goto out;
+        if( (res = vm_copy_to( &process->vm, &argv[i], &argument_str, sizeof( argument_str ) )) < 0 ) goto out;
     }
 
     // set process fields
@@ -151,23 +121,19 @@ out:
 }
 
 void process_free( struct process* process, void* ptr ) {
-    // get the associated allocation
-    struct process_allocation* allocation = process_get_allocation_by_addr( process, ptr );
-    if( NULL == allocation ) return;
+    // only whole heap allocations can be freed
+    if( (uint32_t)ptr < PEACHOS_PROGRAM_HEAP_VIRTUAL_ADDRESS || (uint32_t)ptr >= PEACHOS_PROGRAM_HEAP_VIRTUAL_ADDRESS_END ) return;
 
-    // mark pages as inaccessible
-    paging_map_to( process->task->paging_directory, ptr, ptr, paging_align_ceiling( ptr + allocation->size ), 0 );
-
-    // remove the allocation
-    allocation->ptr = NULL;
-    allocation->size = 0;
-
-    // free the kernel memory
-    kfree( ptr );
+    // drop the area, freeing any frames that were touched
+    vm_unmap( &process->vm, (uint32_t)ptr );
 }
 
 // note: in another OS, there might be something to actually do here
-int process_focus( struct process* process ) { focused_process = process; return 0; }
+int process_focus( struct process* process ) {
+    focused_process = process;
+    shared_page_set_focus( process );
+    return 0;
+}
 
 static int process_load_binary( const char* filename, struct process* process ) {
     // open the file containing the binary
@@ -179,8 +145,9 @@ static int process_load_binary( const char* filename, struct process* process )
     int res = fstat( fd, &stat );
     if( res < 0 ) { fclose( fd ); return res; }
 
-    // allocate program data
-    void* program_data_ptr = kzalloc( stat.filesize );
+    // allocate program data (1 contiguous run, since it gets mapped straight into the process)
+    if( stat.filesize > FRAME_MAX_ALLOCATION ) { fclose( fd ); return -EFBIG; }
+    void* program_data_ptr = frame_zalloc_pages( stat.filesize );
     if( !program_data_ptr ) { res = -ENOMEM; goto out; }
 
     // read program into memory
@@ -192,7 +159,7 @@ static int process_load_binary( const char* filename, struct process* process )
     process->size = stat.filesize;
 
 out:
-    if( res < 0 ) { if( program_data_ptr ) kfree( program_data_ptr ); }
+    if( res < 0 ) { if( program_data_ptr ) frame_free_pages( program_data_ptr, stat.filesize ); }
     fclose( fd ); // close file
     return res;
 }
@@ -219,13 +186,14 @@ static int process_load_data( const char* filename, struct process* process ) {
     return res;
 }
 
+// nothing gets mapped here, the areas just describe where the pages come from when the program touches them
 int process_map_binary( struct process* process ) {
-    return paging_map_to(
-        process->task->paging_directory,
-        (void*)PEACHOS_PROGRAM_VIRTUAL_ADDRESS,
-        process->ptr,
-        paging_align_ceiling( process->ptr + process->size ),
-        PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL | PAGING_IS_WRITEABLE );
+    return vm_map_file(
+        &process->vm,
+        PEACHOS_PROGRAM_VIRTUAL_ADDRESS,
+        (uint32_t)paging_align_ceiling( (void*)(PEACHOS_PROGRAM_VIRTUAL_ADDRESS + process->size) ),
+        PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL | PAGING_IS_WRITEABLE,
+        process->ptr, PEACHOS_PROGRAM_VIRTUAL_ADDRESS, PEACHOS_PROGRAM_VIRTUAL_ADDRESS + process->size );
 }
 
 static int process_map_elf( struct process* process ) {
@@ -233,32 +201,44 @@ static int process_map_elf( struct process* process ) {
     struct elf_file* elf_file = process->elf_file;
     struct elf_header* header = elf_header( elf_file );
 
-    // map each program header into memory
+    // each loadable segment becomes an area
     for( int i = 0; i < header->e_phnum; i++ ) {
         // get next program header
         struct elf32_phdr* program_header = elf_program_header( header, i );
+        if( PT_LOAD != program_header->p_type || 0 == program_header->p_memsz ) continue;
         
         // determine page flags for this segment
         int page_flags = PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL;
         if( PF_W & program_header->p_flags ) page_flags|= PAGING_IS_WRITEABLE;
 
-        // get physical address where we're going to put this segment
+        // file bytes cover [p_vaddr, p_vaddr + p_filesz), the rest of p_memsz (e.g. .bss) is zero-filled
         void* physical_address = elf_program_header_physical_address( elf_file, program_header );
-        
-        // map the memory
-        int res = paging_map_to(
-            process->task->paging_directory,
-            paging_align_floor( (void*)program_header->p_vaddr ),
-            paging_align_floor( physical_address ),
-            paging_align_ceiling( physical_address + program_header->p_memsz ), // bugfix: memsz and filesize might be different (example: static array)
-            page_flags );
+        int res = vm_map_file(
+            &process->vm,
+            (uint32_t)paging_align_floor( (void*)program_header->p_vaddr ),
+            (uint32_t)paging_align_ceiling( (void*)(program_header->p_vaddr + program_header->p_memsz) ),
+            page_flags,
+            physical_address,
+            program_header->p_vaddr,
+            program_header->p_vaddr + program_header->p_filesz );
         if( res < 0 ) return res;
+
+        // read-only pages that are entirely file bytes don't need a copy, so map them straight onto the loaded image
+        // (only possible if the file offset & virtual address line up on a page boundary)
+        if( !(PF_W & program_header->p_flags) && 0 == ((uint32_t)physical_address - program_header->p_vaddr) % PAGING_PAGE_SIZE ) {
+            void *start = paging_align_ceiling( (void*)program_header->p_vaddr ),
+                 *end = paging_align_floor( (void*)(program_header->p_vaddr + program_header->p_filesz) );
+            if( end > start && (res = paging_map_range(
+                    process->task->paging_directory, start, (void*)VIRT_TO_PHYS( physical_address + (start - (void*)program_header->p_vaddr) ),
+                    (end - start) / PAGING_PAGE_SIZE, page_flags )) < 0 )
+                return res;
+        }
     }
     return 0;
 }
 
 int process_map_memory( struct process* process ) {
-    // map the virtual address space for the process' static memory
+    // describe the process' static memory
     int res = 0;
     switch( process->filetype ) {
         case PROCESS_FILETYPE_ELF: res = process_map_elf( process ); break;
@@ -267,13 +247,16 @@ int process_map_memory( struct process* process ) {
     }
     if( res < 0 ) return res;
 
-    // map the virtual address space for the process' stack (otherwise, these will be unmapped, and it will cause a page fault when the process tries to push/pop from its stack)
-    return paging_map_to(
-        process->task->paging_directory,
-        (void*)PEACHOS_PROGRAM_VIRTUAL_STACK_ADDRESS_END, // note that 'end' comes BEFORE start, since stack grows from higher addresses to lower ones
-        process->stack,
-        paging_align_ceiling( process->stack + PEACHOS_USER_PROGRAM_STACK_SIZE ),
+    // & the stack, which starts out w/ a single page & grows (down) as the process touches it
+    res = vm_map_stack(
+        &process->vm,
+        PEACHOS_PROGRAM_VIRTUAL_STACK_ADDRESS_START,
+        PEACHOS_PROGRAM_VIRTUAL_STACK_ADDRESS_END, // note that 'end' comes BEFORE start, since stack grows from higher addresses to lower ones
         PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL | PAGING_IS_WRITEABLE );
+    if( res < 0 ) return res;
+
+    // & the read-only pages userland reads the time & its own info from (w/o a kernel call)
+    return shared_page_map( process );
 }
 
 int process_get_free_slot() {
@@ -281,12 +264,60 @@ int process_get_free_slot() {
     return -EISTKN;
 }
 
+// duplicates a process: the child shares the parent's program image, sees a copy-on-write view of its memory,
+// & resumes from the same point, but w/ eax = 0
+// note: children never get slot 0, so fork can return 0 to the child & the child's id to the parent
+int process_fork( struct process* parent, struct process** child_out ) {
+    // find a slot
+    int slot;
+    for( slot = 1; slot < PEACHOS_MAX_PROCESSES && processes[slot]; slot++ );
+    if( slot >= PEACHOS_MAX_PROCESSES ) return -EISTKN;
+
+    // allocate the process & share the program data
+    struct process* child = slab_zalloc( &process_cache );
+    if( !child ) return -ENOMEM;
+    strncpy( child->filename, parent->filename, sizeof( child->filename ) );
+    child->id = slot;
+    child->filetype = parent->filetype;
+    child->size = parent->size;
+    if( PROCESS_FILETYPE_ELF == parent->filetype ) child->elf_file = elf_share( parent->elf_file );
+    else { child->ptr = parent->ptr; frame_share( parent->ptr ); }
+    child->arguments = parent->arguments; // argv lives in the (copied) process heap, so the pointers stay valid
+
+    // create a task that picks up where the parent left off
+    int res = 0;
+    struct task* task = task_new( child );
+    if( ISERR( task ) ) { res = ERROR_I( task ); goto out; }
+    child->task = task;
+    task->registers = parent->task->registers;
+    task->registers.eax = 0;
+
+    // copy the address space (only page table work, the frames are shared until someone writes)
+    vm_init( &child->vm, task->paging_directory );
+    if( (res = vm_fork( &child->vm, &parent->vm )) < 0 ) goto out;
+    if( (res = shared_page_map( child )) < 0 ) goto out; // (not an area, so vm_fork skips it)
+
+    // add to slot
+    processes[slot] = child;
+    *child_out = child;
+
+out:
+    if( ISERR( res ) ) {
+        vm_destroy( &child->vm );
+        shared_page_free( child );
+        if( child->task ) task_free( child->task );
+        process_free_program_data( child );
+        slab_free( child );
+    }
+    return res;
+}
+
 int process_load_for_slot( const char* filename, struct process** process, int process_slot ) {
     // make sure slot is available
     if( NULL != process_get( process_slot ) ) return -EISTKN;
 
     // allocate process
-    struct process* _process = kzalloc( sizeof( struct process ) );
+    struct process* _process = slab_zalloc( &process_cache );
     if( NULL == _process ) return -ENOMEM;
     
     // initialize the process
@@ -296,19 +327,15 @@ int process_load_for_slot( const char* filename, struct process** process, int p
     int res;
     if( (res = process_load_data( filename, _process )) < 0 ) goto out;
     
-    // allocate stack space (note: this must be 4096 aligned for paging purposes, which is easy since our kzalloc is always aligned)
-    void* program_stack_ptr = kzalloc( PEACHOS_USER_PROGRAM_STACK_SIZE );
-    if( NULL == program_stack_ptr ) { res = -ENOMEM; goto out; }
-
-    // set process filename, stack & id
+    // set process filename & id
     strncpy( _process->filename, filename, sizeof( _process->filename ) );
-    _process->stack = program_stack_ptr;
     _process->id = process_slot;
 
     // create a task
     struct task* task = task_new( _process );
-    if( 0 == ERROR_I( task ) ) { res = ERROR_I( task ); goto out; }
+    if( ISERR( task ) ) { res = ERROR_I( task ); goto out; }
     _process->task = task;
+    vm_init( &_process->vm, task->paging_directory );
 
     // map the memory
     if( (res = process_map_memory( _process ) ) < 0 ) goto out;
@@ -319,6 +346,8 @@ int process_load_for_slot( const char* filename, struct process** process, int p
 
 out:
     if( ISERR( res ) ) {
+        vm_destroy( &_process->vm ); // free memory areas
+        shared_page_free( _process );
         if( _process->task ) task_free( _process->task ); // free task
         // TODO: free the process data
     }
@@ -2,15 +2,13 @@
 #include <stdint.h>
 #include "config.h"
 #include "task.h"
+#include "memory/vm/vm.h"
 
 // process filetype
 #define PROCESS_FILETYPE_ELF 0
 #define PROCESS_FILETYPE_BINARY 1
 typedef uint8_t PROCESS_FILETYPE;
 
-// process allocation object
-struct process_allocation { void* ptr; size_t size; };
-
 // command argument
 struct command_argument { char argument[512]; struct command_argument* next; };
 
@@ -23,19 +21,20 @@ struct process {
     uint16_t id;
     char filename[PEACHOS_MAX_PATH];
     struct task* task;
-    struct process_allocation allocations[PEACHOS_MAX_PROGRAM_ALLOCATIONS]; // memory allocations of the process
+    struct vm_space vm; // memory areas of the process (program image, stack & heap allocations), populated on first touch
+    struct process_page* page; // read-only info page mapped @ PEACHOS_PROCESS_PAGE_ADDRESS
     
     // process memory (which can be either binary or ELF)
     PROCESS_FILETYPE filetype;
     union { void* ptr; struct elf_file* elf_file; };
     
-    void* stack; // stack memory
     uint32_t size; // size of data pointed to by 'ptr'
     
     // keyboard info
     struct keyboard_buffer {
         char buffer[PEACHOS_KEYBOARD_BUFFER_SIZE];
         int tail, head;
+        struct wait_queue waiters; // tasks blocked on an empty buffer
     } keyboard;
 
     // arguments
@@ -53,3 +52,4 @@ void process_free( struct process* process, void* ptr );
 void process_get_arguments( struct process* process, int* argc, char*** argv );
 int process_inject_arguments( struct process* process, struct command_argument* root_argument );
 int process_terminate( struct process* process );
+int process_fork( struct process* parent, struct process** child_out );
@@ -0,0 +1,50 @@
+#include "shared.h"
+#include "process.h"
+#include "status.h"
+#include "memory/memory.h"
+#include "memory/frame/frame.h"
+#include "memory/paging/paging.h"
+#include "timer/timer.h"
+#include "timer/clock.h"
+#include <stddef.h>
+
+// volatile, since userland reads it concurrently (& the tick update has to happen in order)
+static volatile struct shared_page* shared = NULL;
+
+int shared_page_init() {
+    struct shared_page* page = frame_zalloc( PAGING_PAGE_SIZE );
+    if( !page ) return -ENOMEM;
+    const struct clock_source* source = clock_source();
+    page->tick_frequency = timer_frequency();
+    page->tsc = source->tsc;
+    page->tsc_shift = source->tsc_shift;
+    page->clock_frequency = source->frequency;
+    page->tsc_base = source->tsc_base;
+    page->focused_process_id = -1;
+    shared = page;
+    return 0;
+}
+
+void shared_page_tick() {
+    shared->sequence++;
+    shared->ticks = timer_ticks();
+    shared->sequence++;
+}
+
+void shared_page_set_focus( struct process* process ) { shared->focused_process_id = process ? process->id : -1; }
+
+int shared_page_map( struct process* process ) {
+    struct paging_4gb_chunk* directory = process->task->paging_directory;
+    int res = paging_map( directory, (void*)PEACHOS_SHARED_PAGE_ADDRESS, (void*)VIRT_TO_PHYS( shared ), SHARED_PAGE_FLAGS );
+    if( res < 0 ) return res;
+
+    // the process page only changes w/ the process, so it's filled in once
+    if( !process->page && !(process->page = frame_zalloc( PAGING_PAGE_SIZE )) ) return -ENOMEM;
+    process->page->process_id = process->id;
+    return paging_map( directory, (void*)PEACHOS_PROCESS_PAGE_ADDRESS, (void*)VIRT_TO_PHYS( process->page ), SHARED_PAGE_FLAGS );
+}
+
+void shared_page_free( struct process* process ) {
+    frame_free( process->page );
+    process->page = NULL;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <stdint.h>
+
+struct process;
+
+// page flags for both pages: userland may read them, only the kernel (via its own mapping) writes
+#define SHARED_PAGE_FLAGS (PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL)
+
+// kernel data every process can read w/o a kernel call (stdlib/peachos.h mirrors this layout)
+// the tick count is 64 bits, so it can't be read in 1 go: 'sequence' is odd while the kernel updates it,
+// & readers retry until they see the same even sequence before & after
+struct shared_page {
+    uint32_t sequence;
+    uint64_t ticks;
+    uint32_t tick_frequency;
+
+    // monotonic clock (see struct clock_source)
+    uint32_t tsc, tsc_shift, clock_frequency;
+    uint64_t tsc_base;
+
+    int32_t focused_process_id; // -1 if there isn't one
+};
+
+// per process
+struct process_page { int32_t process_id; };
+
+int shared_page_init(); // after clock_init (it copies the clock's calibration)
+void shared_page_tick(); // called on every timer interrupt
+void shared_page_set_focus( struct process* process );
+int shared_page_map( struct process* process ); // maps the shared page & the process' own page (allocating it) into its address space
+void shared_page_free( struct process* process ); // frees the process' own page
@@ -4,6 +4,7 @@ section .asm
 global restore_general_purpose_registers
 global task_return
 global user_registers
+global switch_to
 
 ; this drops us into userland
 ; note that the values pushed are in virtual address space, b/c we have paging enabled
@@ -70,3 +71,24 @@ user_registers:
     mov fs, ax
     mov gs, ax
     ret
+
+; kernel stack switch: the outgoing task's callee-saved registers stay on its own stack, so saving esp is enough
+; void switch_to( uint32_t* old_esp, uint32_t new_esp );
+switch_to:
+    mov eax, [esp+4] ; old_esp
+    mov edx, [esp+8] ; new_esp
+
+    ; save the callee-saved registers & the stack pointer
+    push ebp
+    push ebx
+    push esi
+    push edi
+    mov [eax], esp
+
+    ; resume the other stack (which was saved by switch_to, or set up to look like it was)
+    mov esp, edx
+    pop edi
+    pop esi
+    pop ebx
+    pop ebp
+    ret
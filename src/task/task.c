@@ -8,41 +8,153 @@
 #include "memory/paging/paging.h"
 #include "string/string.h"
 #include "loader/formats/elfloader.h"
+#include "memory/heap/slab.h"
+#include "memory/frame/frame.h"
+#include "task/tss.h"
 
 // data
 struct task* current_task = NULL; // current task that's running
 struct task* task_tail = NULL; // tail of the linked list (last insertion)
 struct task* task_head = NULL; // head of the linked list (first insertion)
+static struct slab_cache task_cache = SLAB_CACHE( "task", sizeof( struct task ) );
+static struct task* task_dead = NULL; // exited task whose kernel stack we were still on, freed once we're off it
+static uint32_t task_boot_esp; // where switch_to parks kernel_main's stack when the 1st task starts
+
+// run queues (multi-level feedback): one FIFO per priority level, & a bit per non-empty level
+static struct task_queue { struct task *head, *tail; } task_run_queues[PEACHOS_TASK_PRIORITY_LEVELS];
+static uint32_t task_ready_levels = 0;
+static int task_boost_countdown = PEACHOS_TASK_BOOST_TICKS;
+
+// the idle task: a kernel-only task that halts the cpu, & only runs when nothing else can
+static struct task* task_idle = NULL;
+static uint32_t task_idle_ticks = 0, task_total_ticks = 0;
 
 // functions
 struct task* task_current() { return current_task; } // returns the current task
 
-// does a round-robin loop through the task list (can return NULL if no tasks)
-struct task* task_get_next() { return current_task->next ? current_task->next : task_head; }
+// -- SCHEDULER --
+
+// could go on a run queue (i.e. isn't exited, blocked or the idle task)
+static bool task_is_runnable( struct task* task ) { return task != task_dead && task != task_idle && !task->waiting; }
+
+// runnable tasks wait @ the tail of their level's queue (the running task isn't on any queue)
+static void task_enqueue( struct task* task ) {
+    struct task_queue* queue = &task_run_queues[task->priority];
+    task->run_prev = queue->tail;
+    task->run_next = NULL;
+    if( queue->tail ) queue->tail->run_next = task; else queue->head = task;
+    queue->tail = task;
+    task->queued = true;
+    task_ready_levels|= 1 << task->priority;
+}
+
+static void task_dequeue( struct task* task ) {
+    struct task_queue* queue = &task_run_queues[task->priority];
+    if( task->run_prev ) task->run_prev->run_next = task->run_next; else queue->head = task->run_next;
+    if( task->run_next ) task->run_next->run_prev = task->run_prev; else queue->tail = task->run_prev;
+    task->run_next = task->run_prev = NULL;
+    task->queued = false;
+    if( !queue->head ) task_ready_levels&= ~(1 << task->priority);
+}
 
+// the highest priority runnable task, in O(1): lowest set bit = highest non-empty level (can return NULL if no tasks)
+struct task* task_get_next() {
+    if( !task_ready_levels ) return NULL;
+    return task_run_queues[__builtin_ctz( task_ready_levels )].head;
+}
+
+// lower priorities get longer quanta (they run less often, so they should get more done when they do)
+static int task_quantum( struct task* task ) { return PEACHOS_TASK_QUANTUM_TICKS << task->priority; }
+
+// moves a task to another level (keeping its place in line if it's waiting to run)
+static void task_set_priority( struct task* task, int priority ) {
+    if( priority < 0 ) priority = 0;
+    if( priority >= PEACHOS_TASK_PRIORITY_LEVELS ) priority = PEACHOS_TASK_PRIORITY_LEVELS - 1;
+    if( priority == task->priority ) return;
+    bool queued = task->queued;
+    if( queued ) task_dequeue( task );
+    task->priority = priority;
+    task->quantum = task_quantum( task );
+    if( queued ) task_enqueue( task );
+}
+
+// every so often, everyone goes back to the top (so demoted tasks can't starve, & a task that turns interactive recovers)
+static void task_boost_all() {
+    for( struct task* task = task_head; task; task = task->next ) task_set_priority( task, 0 );
+}
+
+// every task is on the task list, & new ones are ready to run (@ the top priority)
 static void task_list_insert( struct task* task ) {
-    if( NULL == task_head ) { current_task = task_head = task_tail = task; return; }    
+    task_enqueue( task );
+    if( NULL == task_head ) { task_head = task_tail = task; return; }
     task_tail->next = task;
     task->prev = task_tail;
     task_tail = task;
 }
 
+static void task_wait_remove( struct task* task );
+
 static void task_list_remove( struct task* task ) {
+    if( task->queued ) task_dequeue( task );
+    if( task->waiting ) task_wait_remove( task );
     if( task->prev ) task->prev->next = task->next;
+    if( task->next ) task->next->prev = task->prev;
     if( task_head == task ) task_head = task->next;
     if( task_tail == task ) task_tail = task->prev;
-    if( current_task == task ) current_task = task_get_next();
+}
+
+// a new task's 1st switch_to 'returns' here, on its fresh kernel stack
+static void task_entry() {
+    task_reap();
+    task_return( &current_task->registers );
+}
+
+// sets up a kernel stack so the 1st switch_to into it 'returns' into 'entry'
+static int task_init_kernel_stack( struct task* task, void(*entry)() ) {
+    task->kernel_stack = frame_alloc( PEACHOS_TASK_KERNEL_STACK_SIZE );
+    if( !task->kernel_stack ) return -ENOMEM;
+    uint32_t* stack = task->kernel_stack + PEACHOS_TASK_KERNEL_STACK_SIZE;
+    *--stack = (uint32_t)entry; // return address
+    for( int i = 0; i < 4; i++ ) *--stack = 0; // ebp, ebx, esi, edi
+    task->kernel_esp = (uint32_t)stack;
+    return 0;
+}
+
+// runs in the kernel w/ interrupts on, until the timer finds something else to run
+// (an interrupt that wakes a task gets it running right away, rather than on the next tick)
+static void task_idle_main() {
+    task_reap();
+    while( 1 ) {
+        idle_halt();
+        disable_interrupts();
+        if( task_get_next() ) task_next();
+    }
+}
+
+static void task_idle_init() {
+    task_idle = slab_zalloc( &task_cache );
+    if( !task_idle || task_init_kernel_stack( task_idle, task_idle_main ) < 0 ) panic( "failed to create the idle task\n" );
+    task_idle->paging_directory = paging_kernel_4gb();
+}
+
+// percentage of ticks (since boot) that the cpu spent halted in the idle task
+int task_idle_percent() {
+    if( task_total_ticks < 100 ) return 0;
+    return task_idle_ticks / (task_total_ticks / 100);
 }
 
 int task_init( struct task* task, struct process* process ) {
     // clear structure
     memset( task, 0, sizeof( struct task ) );
 
-    // map entire 4GB address space to itself (identity transform)
-    // this is a read-only address space
-    task->paging_directory = paging_new_4gb( PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL );
+    // new address space (the kernel is mapped in, but it's invisible from userland)
+    task->paging_directory = paging_new_4gb();
     if( !task->paging_directory ) return -EIO;
 
+    // kernel stack, set up as if switch_to had saved it (so the 1st switch 'returns' into task_entry)
+    int res = task_init_kernel_stack( task, task_entry );
+    if( res < 0 ) return res;
+
     // initialze the registers
     task->registers.ip = PROCESS_FILETYPE_ELF == process->filetype ?
                          elf_header( process->elf_file )->e_entry :
@@ -54,27 +166,114 @@ int task_init( struct task* task, struct process* process ) {
     return 0;
 }
 
+// a task can free itself (i.e. exit), but its kernel stack has to live until the switch away from it
 int task_free( struct task* task ) {
-    paging_free_4gb( task->paging_directory );
+    if( task->paging_directory ) paging_free_4gb( task->paging_directory );
+    task->paging_directory = NULL;
     task_list_remove( task );
-    kfree( task );
+    if( current_task == task ) { task_dead = task; return 0; }
+    frame_free( task->kernel_stack );
+    slab_free( task );
     return 0;
 }
 
+// frees the task that just exited (called right after every switch, once we're on the new task's stack)
+void task_reap() {
+    if( !task_dead ) return;
+    frame_free( task_dead->kernel_stack );
+    slab_free( task_dead );
+    task_dead = NULL;
+}
+
+// switches to the next task, returning when this one gets to run again (never, if it has exited)
+// (the current task goes to the back of its queue 1st, so equal priorities take turns)
+// (& if there's nothing else to run, it's the idle task's turn)
 void task_next() {
+    if( current_task && task_is_runnable( current_task ) && !current_task->queued ) task_enqueue( current_task );
     struct task* next_task = task_get_next();
-    if( !next_task ) panic( "No more tasks!\n" );
-    task_switch( next_task );
-    task_return( &next_task->registers );
+    task_run( next_task ? next_task : task_idle );
+}
+
+// called on every timer tick: the current task keeps the cpu until its quantum runs out,
+// & a task that uses up a whole quantum is probably cpu bound, so it drops a level
+void task_tick() {
+    if( --task_boost_countdown <= 0 ) { task_boost_countdown = PEACHOS_TASK_BOOST_TICKS; task_boost_all(); }
+
+    // the idle task gives way as soon as anything is runnable
+    task_total_ticks++;
+    if( task_idle == current_task ) {
+        task_idle_ticks++;
+        if( task_get_next() ) task_next();
+        return;
+    }
+    if( !current_task || --current_task->quantum > 0 ) return;
+    task_set_priority( current_task, current_task->priority + 1 );
+    task_next();
+}
+
+// lets other tasks run w/o blocking (e.g. while polling for a key): the task keeps its level & what's left of its quantum,
+// so a polling loop still uses the quantum up & gets demoted (only real waits, via task_wait, earn the top priority)
+void task_yield() {
+    if( !current_task ) return;
+    task_next();
+}
+
+// -- WAIT QUEUES --
+
+static void task_wait_remove( struct task* task ) {
+    struct wait_queue* queue = task->waiting;
+    if( task->run_prev ) task->run_prev->run_next = task->run_next; else queue->head = task->run_next;
+    if( task->run_next ) task->run_next->run_prev = task->run_prev; else queue->tail = task->run_prev;
+    task->run_next = task->run_prev = NULL;
+    task->waiting = NULL;
+}
+
+// sleeps until someone calls task_wake_all on the queue (the caller should re-check whatever it was waiting for)
+// waiting means the task is I/O bound, so it's boosted to the top priority
+void task_wait( struct wait_queue* queue ) {
+    struct task* task = current_task;
+    if( !task || task_idle == task ) panic( "task_wait: only a task can block\n" );
+    task->waiting = queue;
+    task->run_prev = queue->tail;
+    task->run_next = NULL;
+    if( queue->tail ) queue->tail->run_next = task; else queue->head = task;
+    queue->tail = task;
+    task_set_priority( task, 0 );
+    task->quantum = task_quantum( task ); // (a fresh one, even if it was already @ the top)
+    task_next();
+}
+
+// makes every waiter runnable (safe from an interrupt handler, it doesn't switch tasks itself)
+void task_wake_all( struct wait_queue* queue ) {
+    while( queue->head ) {
+        struct task* task = queue->head;
+        task_wait_remove( task );
+        task_enqueue( task );
+    }
 }
 
 // change the current task that's running & change the page directories to point to the tasks'
+// (interrupts & kernel calls from the task come in on its own kernel stack)
 int task_switch( struct task* task ) {
     current_task = task;
     paging_switch( task->paging_directory );
+    tss.esp0 = (uint32_t)task->kernel_stack + PEACHOS_TASK_KERNEL_STACK_SIZE;
     return 0;
 }
 
+// runs 'task' on its own kernel stack, saving ours (so we pick up right here when we're switched back to)
+// (the task comes off its run queue, & if we're still runnable, we go back on ours)
+void task_run( struct task* task ) {
+    struct task* prev = current_task;
+    if( task->queued ) task_dequeue( task );
+    if( prev && prev != task && task_is_runnable( prev ) && !prev->queued ) task_enqueue( prev );
+    if( task->quantum <= 0 ) task->quantum = task_quantum( task ); // (a task that yielded carries on w/ what it had left)
+    if( prev == task ) return;
+    task_switch( task );
+    switch_to( prev ? &prev->kernel_esp : &task_boot_esp, task->kernel_esp );
+    task_reap();
+}
+
 void task_save_state( struct task* task, struct interrupt_frame* frame ) {
     task->registers.ip = frame->ip;
     task->registers.cs = frame->cs;
@@ -90,43 +289,11 @@ void task_save_state( struct task* task, struct interrupt_frame* frame ) {
     task->registers.esi = frame->esi;
 }
 
-// the 'virtual' address is in userspace, so we cannot directly access from kernelland
-int copy_string_from_task( struct task* task, void* virtual, void* physical, int max ) {
-    // allocate a page-aligned buffer that is < PAGE_SIZE
-    if( max >= PAGING_PAGE_SIZE ) return -EINVARG;
-    char* tmp = kzalloc( max );
-    if( NULL == tmp ) return -ENOMEM;
-
-    // backup the task page, because it may point to physical memory that the process is using
-    // (process is frozen, so it won't need this page for now)
-    uint32_t *task_directory = task->paging_directory->directory_entry,
-             old_entry = paging_get( task_directory, tmp );
-
-    // point virtual address 'tmp' to physical (kernel) address 'tmp'
-    // TODO: why do we need 'tmp'? can't we just map somewhere directly to 'physical' and do the copy in user space?
-    paging_map( task->paging_directory, tmp, tmp, PAGING_IS_WRITEABLE | PAGING_IS_PRESENT | PAGING_ACCESS_FROM_ALL );
-    
-    // switch to task's address space (note that 'tmp' is being mapped into process space)
-    paging_switch( task->paging_directory );
-
-    // copy into tmp from virtual TODO: what if 'virtual' is located in 'tmp'?
-    strncpy( tmp, virtual, max );
-
-    // switch back to the kernel address space
-    kernel_page();
-    
-    // restore the task's page
-    int res = 0;
-    if( paging_set( task_directory, tmp, old_entry ) < 0 ) { res = -EIO; goto out; }
-
-    // copy from 'tmp' into the destination
-    strncpy( physical, tmp, max );
-
-    // deallocate the 'tmp' memory
-out:
-    kfree( tmp );
-    return res;
-}
+// user pointers are translated page by page through the process' page tables (faulting pages in as needed)
+// so the copy goes straight to/from the frames, whatever address space is live
+int copy_from_user( struct task* task, void* to, const void* from, size_t size ) { return vm_copy_from( &task->process->vm, to, from, size ); }
+int copy_to_user( struct task* task, void* to, const void* from, size_t size ) { return vm_copy_to( &task->process->vm, to, from, size ); }
+int strncpy_from_user( struct task* task, char* to, const char* from, int max ) { return vm_strncpy_from( &task->process->vm, to, from, max ); }
 
 void task_current_save_state( struct interrupt_frame* frame ) {
     struct task* task = task_current();
@@ -139,7 +306,7 @@ void task_current_save_state( struct interrupt_frame* frame ) {
 // before switching the task
 int task_page() {
     user_registers();
-    task_switch( current_task );
+    if( current_task ) task_switch( current_task );
     return 0;
 }
 
@@ -152,17 +319,16 @@ int task_page_task( struct task* task ) {
 void task_run_first_ever_task() {
     // check to ensure we have at least one task
     if( !task_head ) panic( "task_run_first_ever_task(): No tasks exist!\n" );
+    task_idle_init();
     
-    // switch the page directory & set current_task
-    task_switch( task_head );
-
-    // drop into userland
-    task_return( &task_head->registers );
+    // switch to its kernel stack, which drops it into userland (kernel_main's stack is never resumed)
+    task_run( task_head );
+    panic( "task_run_first_ever_task(): returned to the boot stack!\n" );
 }
 
 struct task* task_new( struct process* process ) {
     // allocate the task
-    struct task* task = kzalloc( sizeof( struct task ) );
+    struct task* task = slab_zalloc( &task_cache );
     if( !task ) return ERROR( -ENOMEM );
 
     // initialize the task
@@ -177,22 +343,10 @@ out:
     return task;
 }
 
-// reads ith item from task's stack
+// reads ith item from task's stack (NULL if the stack isn't readable)
 void* task_get_stack_item( struct task* task, int i ) {
-    // get virtual stack pointer
     uint32_t* virtual_stack = (uint32_t*)task->registers.esp;
-
-    // switch to the task's page
-    task_page_task( task );
-
-    // read the value in task address space
-    void* value = (void*)virtual_stack[i];
-
-    // switch back to the kernel page
-    kernel_page();
+    void* value = NULL;
+    if( copy_from_user( task, &value, &virtual_stack[i], sizeof( value ) ) < 0 ) return NULL;
     return value;
 }
-
-void* task_virtual_address_to_physical( struct task* task, void* virt ) {
-    return paging_get_physical_address( task->paging_directory->directory_entry, virt );
-}
@@ -25,10 +25,20 @@ struct registers {
 // forward declarations
 struct process;
 
+// tasks blocked until some event (woken in the order they started waiting)
+struct wait_queue { struct task *head, *tail; };
+
 // types
 struct task {
     struct paging_4gb_chunk* paging_directory; // page tables for this task
     struct registers registers; // holds registers when task is not running
+    void* kernel_stack; // PEACHOS_TASK_KERNEL_STACK_SIZE bytes (interrupts & kernel calls from this task run on it)
+    uint32_t kernel_esp; // saved kernel stack pointer while switched out (see switch_to)
+    int quantum; // ticks left before it's preempted (refilled once it's used up, or when the task changes level or blocks)
+    int priority; // run queue level, 0 = highest (drops when the task uses up its quantum, rises when it waits on I/O)
+    bool queued; // on a run queue (i.e. runnable, but not running)
+    struct wait_queue* waiting; // the wait queue it's blocked on (NULL if it isn't)
+    struct task *run_next, *run_prev; // run queue links (or wait queue links, while it's blocked)
     struct process* process;
     struct task *next, *prev; // previous & next task in the linked list
 };
@@ -39,16 +49,27 @@ struct task* task_current();
 struct task* task_get_next();
 int task_free( struct task* task );
 int task_switch( struct task* task );
+void task_run( struct task* task );
+void task_reap();
 int task_page();
 int task_page_task( struct task* task );
 void task_run_first_ever_task();
 void task_next();
+void task_tick();
+void task_yield();
+int task_idle_percent();
+void task_wait( struct wait_queue* queue ); // blocks the current task until the queue is woken
+void task_wake_all( struct wait_queue* queue );
 void task_current_save_state( struct interrupt_frame* frame );
-int copy_string_from_task( struct task* task, void* virtual, void* physical, int max );
 void* task_get_stack_item( struct task* task, int i );
-void* task_virtual_address_to_physical( struct task* task, void* virt );
+
+// copies between kernel memory & a task's userspace (< 0 if a user page is missing or off limits)
+int copy_from_user( struct task* task, void* to, const void* from, size_t size );
+int copy_to_user( struct task* task, void* to, const void* from, size_t size );
+int strncpy_from_user( struct task* task, char* to, const char* from, int max ); // returns the string length (truncated to fit)
 
 // assembly functions
 void restore_general_purpose_registers( struct registers* regs) ;
 void task_return( struct registers* regs );
+void switch_to( uint32_t* old_esp, uint32_t new_esp ); // saves callee-saved registers & esp into 'old_esp', then resumes the stack @ 'new_esp'
 void user_registers();
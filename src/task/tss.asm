@@ -14,3 +14,25 @@ tss_load:
     ; C function exit
     pop ebp
     ret
+
+global tss_has_sysenter
+global tss_write_msr
+
+; bool tss_has_sysenter(); (cpuid leaf 1: edx bit 11 = SEP)
+tss_has_sysenter:
+    push ebx ; cpuid clobbers ebx, which belongs to our caller
+    mov eax, 1
+    cpuid
+    xor eax, eax
+    bt edx, 11
+    setc al
+    pop ebx
+    ret
+
+; void tss_write_msr( uint32_t msr, uint32_t value ); (upper 32 bits are always 0)
+tss_write_msr:
+    mov ecx, [esp+4]
+    mov eax, [esp+8]
+    xor edx, edx
+    wrmsr
+    ret
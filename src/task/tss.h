@@ -1,5 +1,12 @@
 #pragma once
 #include <stdint.h>
+#include <stdbool.h>
+
+// model specific registers for fast kernel calls (SYSENTER loads cs, eip & esp from these, ss = cs + 8)
+// (SYSEXIT returns to cs + 16 & ss + 24, so the GDT must have user code & data right after the kernel's)
+#define TSS_MSR_SYSENTER_CS  0x174
+#define TSS_MSR_SYSENTER_ESP 0x175
+#define TSS_MSR_SYSENTER_EIP 0x176
 
 struct tss { // task state segment
     uint32_t link;
@@ -29,4 +36,8 @@ struct tss { // task state segment
     uint32_t iopb;
 } __attribute__((packed));
 
+extern struct tss tss; // the only TSS (esp0 = the current task's kernel stack)
+
 void tss_load( int tss_segment );
+bool tss_has_sysenter();
+void tss_write_msr( uint32_t msr, uint32_t value );
@@ -0,0 +1,56 @@
+section .asm
+
+global clock_has_tsc
+global clock_rdtsc
+global clock_div64
+
+; bool clock_has_tsc(); (cpuid leaf 1: edx bit 4 = TSC)
+clock_has_tsc:
+    ; cpuid only exists if we can flip EFLAGS.ID (bit 21)
+    pushfd
+    pop eax
+    mov ecx, eax
+    xor eax, 0x200000
+    push eax
+    popfd
+    pushfd
+    pop eax
+    push ecx ; put the original flags back
+    popfd
+    xor eax, ecx
+    jz .done ; (eax is already 0 = false)
+
+    push ebx ; cpuid clobbers ebx, which belongs to our caller
+    mov eax, 1
+    cpuid
+    xor eax, eax
+    bt edx, 4
+    setc al
+    pop ebx
+.done:
+    ret
+
+; uint64_t clock_rdtsc(); (rdtsc already returns in edx:eax, like a C function returning a uint64_t)
+clock_rdtsc:
+    rdtsc
+    ret
+
+; uint64_t clock_div64( uint64_t dividend, uint32_t divisor, uint32_t* remainder );
+; (2 divs: the high half's remainder becomes the top of the 2nd dividend, so neither can overflow)
+clock_div64:
+    push ebx
+    mov ecx, [esp+16] ; divisor
+    mov eax, [esp+12] ; dividend (high)
+    xor edx, edx
+    div ecx
+    mov ebx, eax ; quotient (high)
+    mov eax, [esp+8] ; dividend (low)
+    div ecx
+    mov ecx, [esp+20] ; remainder pointer
+    test ecx, ecx
+    jz .done
+    mov [ecx], edx
+.done:
+    mov edx, ebx ; edx:eax = quotient
+    pop ebx
+    ret
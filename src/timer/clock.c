@@ -0,0 +1,58 @@
+#include "clock.h"
+#include "io/io.h"
+#include "status.h"
+#include <stddef.h>
+
+static struct clock_source source = { 0 };
+
+// counts cpu cycles while PIT channel 2 counts down CLOCK_CALIBRATE_MS
+static uint64_t clock_calibrate() {
+    uint8_t speaker = insb( CLOCK_SPEAKER_PORT );
+    outb( CLOCK_SPEAKER_PORT, speaker & ~0b11 ); // gate low (& speaker off), so the count doesn't start until we're ready
+    uint32_t count = TIMER_PIT_FREQUENCY * CLOCK_CALIBRATE_MS / 1000;
+    outb( TIMER_PIT_COMMAND, CLOCK_PIT_MODE_ONESHOT );
+    outb( CLOCK_PIT_CHANNEL2, count & 0xFF );
+    outb( CLOCK_PIT_CHANNEL2, (count >> 8) & 0xFF );
+
+    // raising the gate starts the count, & the output goes high when it reaches 0
+    outb( CLOCK_SPEAKER_PORT, (speaker & ~0b10) | 0b01 );
+    uint64_t start = clock_rdtsc();
+    while( !(insb( CLOCK_SPEAKER_PORT ) & 0b100000) );
+    uint64_t cycles = clock_rdtsc() - start;
+    outb( CLOCK_SPEAKER_PORT, speaker );
+    return cycles;
+}
+
+void clock_init() {
+    source.tsc = clock_has_tsc();
+    if( !source.tsc ) { source.frequency = timer_frequency(); return; }
+    uint64_t cycles = clock_calibrate();
+    while( cycles * (1000 / CLOCK_CALIBRATE_MS) > 0xFFFFFFFF ) { cycles>>= 1; source.tsc_shift++; }
+    source.frequency = (uint32_t)cycles * (1000 / CLOCK_CALIBRATE_MS);
+    source.tsc_base = clock_rdtsc();
+}
+
+const struct clock_source* clock_source() { return &source; }
+
+uint32_t clock_frequency() { return source.frequency; }
+
+static uint64_t clock_read() { return source.tsc ? (clock_rdtsc() - source.tsc_base) >> source.tsc_shift : timer_ticks(); }
+
+// (remainder * 1e9 < 2^32 * 1e9, which fits 64 bits)
+static void clock_split( uint64_t count, uint32_t* seconds, uint32_t* ns ) {
+    uint32_t remainder;
+    *seconds = (uint32_t)clock_div64( count, source.frequency, &remainder );
+    *ns = (uint32_t)clock_div64( (uint64_t)remainder * 1000000000, source.frequency, NULL );
+}
+
+uint64_t ktime_get_ns() {
+    uint32_t seconds, ns;
+    clock_split( clock_read(), &seconds, &ns );
+    return (uint64_t)seconds * 1000000000 + ns;
+}
+
+int clock_gettime( int clock, struct timespec* out ) {
+    if( CLOCK_MONOTONIC != clock ) return -EINVARG;
+    clock_split( clock_read(), &out->tv_sec, &out->tv_nsec );
+    return 0;
+}
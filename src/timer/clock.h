@@ -0,0 +1,36 @@
+// https://wiki.osdev.org/TSC
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "timer.h"
+
+// clock ids (same numbering as posix)
+#define CLOCK_REALTIME 0 // (not supported: there's no rtc yet)
+#define CLOCK_MONOTONIC 1
+
+// calibration uses PIT channel 2, whose gate & output are wired to the speaker port
+#define CLOCK_PIT_CHANNEL2 0x42
+#define CLOCK_PIT_MODE_ONESHOT 0b10110000 // channel 2, lobyte/hibyte access, mode 0 (interrupt on terminal count), binary
+#define CLOCK_SPEAKER_PORT 0x61 // bit 0 = channel 2 gate, bit 1 = speaker enable, bit 5 = channel 2 output
+#define CLOCK_CALIBRATE_MS 50 // (the PIT count must fit 16 bits, so 54 at most)
+
+// the counter behind the clock: (rdtsc - tsc_base) >> tsc_shift if there's a TSC, otherwise the PIT tick count
+struct clock_source {
+    bool tsc;
+    uint32_t tsc_shift; // a > 4 GHz TSC gets scaled down, so its frequency fits the 32 bit divisor
+    uint32_t frequency; // Hz of the (scaled) counter
+    uint64_t tsc_base;
+};
+
+void clock_init(); // calibrates the TSC against the PIT (falls back to counting PIT ticks if the cpu has no TSC)
+const struct clock_source* clock_source(); // (lets userland read the clock itself, from the shared page)
+uint32_t clock_frequency(); // Hz of the underlying counter
+
+// monotonic time since clock_init
+uint64_t ktime_get_ns();
+int clock_gettime( int clock, struct timespec* out );
+
+// asm helpers (gcc would otherwise need libgcc for 64 bit division)
+bool clock_has_tsc();
+uint64_t clock_rdtsc();
+uint64_t clock_div64( uint64_t dividend, uint32_t divisor, uint32_t* remainder ); // 'remainder' may be NULL
@@ -0,0 +1,140 @@
+#include "timer.h"
+#include "io/io.h"
+#include "status.h"
+#include "task/task.h"
+#include <stddef.h>
+
+static uint64_t ticks = 0;
+static uint32_t frequency = 0;
+
+// the wheel: 'wheel_now' is the next tick to process
+static struct timer* timer_root[1 << TIMER_WHEEL_ROOT_BITS];
+static struct timer* timer_levels[TIMER_WHEEL_LEVELS][1 << TIMER_WHEEL_LEVEL_BITS];
+static uint32_t wheel_now = 0;
+
+void timer_init( uint32_t hz ) {
+    // the divisor is 16 bits (where 0 means 65536, the BIOS default of ~18.2 Hz)
+    uint32_t divisor = hz ? TIMER_PIT_FREQUENCY / hz : 0x10000;
+    if( divisor < 1 ) divisor = 1;
+    if( divisor > 0x10000 ) divisor = 0x10000;
+    frequency = TIMER_PIT_FREQUENCY / divisor;
+
+    // program channel 0
+    outb( TIMER_PIT_COMMAND, TIMER_PIT_MODE_RATE );
+    outb( TIMER_PIT_CHANNEL0, divisor & 0xFF );
+    outb( TIMER_PIT_CHANNEL0, (divisor >> 8) & 0xFF );
+}
+
+uint64_t timer_ticks() { return ticks; }
+
+uint32_t timer_frequency() { return frequency; }
+
+// -- WHEEL --
+
+static void timer_link( struct timer** slot, struct timer* timer ) {
+    timer->slot = slot;
+    timer->prev = NULL;
+    timer->next = *slot;
+    if( *slot ) (*slot)->prev = timer;
+    *slot = timer;
+}
+
+// near timers go in the root slot for their exact tick, far ones in a coarser level (& get cascaded down as it comes round)
+static struct timer** timer_slot( uint32_t expires ) {
+    uint32_t delay = expires - wheel_now;
+    if( (int32_t)delay < 0 ) return &timer_root[wheel_now & ((1 << TIMER_WHEEL_ROOT_BITS) - 1)]; // overdue: next tick
+    if( delay < (1 << TIMER_WHEEL_ROOT_BITS) ) return &timer_root[expires & ((1 << TIMER_WHEEL_ROOT_BITS) - 1)];
+    for( int level = 0; level < TIMER_WHEEL_LEVELS; level++ ) {
+        int shift = TIMER_WHEEL_ROOT_BITS + level * TIMER_WHEEL_LEVEL_BITS;
+        if( level == TIMER_WHEEL_LEVELS - 1 || delay < (1u << (shift + TIMER_WHEEL_LEVEL_BITS)) )
+            return &timer_levels[level][(expires >> shift) & ((1 << TIMER_WHEEL_LEVEL_BITS) - 1)];
+    }
+    return NULL;
+}
+
+void timer_add( struct timer* timer, uint32_t delay, TIMER_FUNCTION function, void* data ) {
+    timer_cancel( timer );
+    if( delay > TIMER_WHEEL_MAX_DELAY ) delay = TIMER_WHEEL_MAX_DELAY;
+    timer->expires = wheel_now + delay;
+    timer->function = function;
+    timer->data = data;
+    timer_link( timer_slot( timer->expires ), timer );
+}
+
+void timer_cancel( struct timer* timer ) {
+    if( !timer->slot ) return;
+    if( timer->next ) timer->next->prev = timer->prev;
+    if( timer->prev ) timer->prev->next = timer->next; else *timer->slot = timer->next;
+    timer->next = timer->prev = NULL;
+    timer->slot = NULL;
+}
+
+// empties a slot of a coarser level back into the wheel (returns the slot's index, 0 means the next level is due as well)
+static int timer_cascade( int level ) {
+    int index = (wheel_now >> (TIMER_WHEEL_ROOT_BITS + level * TIMER_WHEEL_LEVEL_BITS)) & ((1 << TIMER_WHEEL_LEVEL_BITS) - 1);
+    struct timer* timer = timer_levels[level][index];
+    timer_levels[level][index] = NULL;
+    for( struct timer* next; timer; timer = next ) {
+        next = timer->next;
+        timer_link( timer_slot( timer->expires ), timer );
+    }
+    return index;
+}
+
+// each tick only touches 1 root slot (& every 256 ticks, 1 slot of the level above, etc.)
+void timer_tick() {
+    ticks++;
+
+    // pull the next lap's timers down once the root comes round
+    int index = wheel_now & ((1 << TIMER_WHEEL_ROOT_BITS) - 1);
+    for( int level = 0; 0 == index && level < TIMER_WHEEL_LEVELS; level++ ) index = timer_cascade( level );
+
+    // fire this tick's timers
+    struct timer** slot = &timer_root[wheel_now & ((1 << TIMER_WHEEL_ROOT_BITS) - 1)];
+    wheel_now++;
+    while( *slot ) {
+        struct timer* timer = *slot;
+        timer_cancel( timer );
+        timer->function( timer->data );
+    }
+}
+
+// -- SLEEPING --
+
+struct timer_sleeper { struct timer timer; struct wait_queue queue; bool done; };
+
+static void timer_wake( void* data ) {
+    struct timer_sleeper* sleeper = data;
+    sleeper->done = true;
+    task_wake_all( &sleeper->queue );
+}
+
+// (the +1 is b/c we're already partway through the current tick)
+void timer_sleep_ticks( uint32_t count ) {
+    while( count > 0 ) {
+        uint32_t delay = count < TIMER_WHEEL_MAX_DELAY ? count : TIMER_WHEEL_MAX_DELAY - 1;
+        struct timer_sleeper sleeper = { 0 };
+        timer_add( &sleeper.timer, delay + 1, timer_wake, &sleeper );
+        while( !sleeper.done ) task_wait( &sleeper.queue );
+        count-= delay;
+    }
+}
+
+void timer_sleep_ms( uint32_t ms ) {
+    struct timespec duration = { .tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000 };
+    timer_nanosleep( &duration );
+}
+
+// rounds up to whole ticks (& sleeps whole seconds in chunks, since tv_sec * frequency can overflow 32 bits)
+int timer_nanosleep( const struct timespec* duration ) {
+    if( duration->tv_nsec >= 1000000000 ) return -EINVARG;
+    // (the PIT isn't programmed until timer_init, & we'd divide by zero)
+    if( !frequency ) return -ENOTREADY;
+    uint32_t ns_per_tick = 1000000000 / frequency, max_seconds = TIMER_WHEEL_MAX_DELAY / frequency;
+    for( uint32_t seconds = duration->tv_sec, chunk; seconds > 0; seconds-= chunk ) {
+        chunk = seconds < max_seconds ? seconds : max_seconds;
+        timer_sleep_ticks( chunk * frequency );
+    }
+    timer_sleep_ticks( (duration->tv_nsec + ns_per_tick - 1) / ns_per_tick );
+    return 0;
+}
@@ -0,0 +1,43 @@
+// https://wiki.osdev.org/Programmable_Interval_Timer
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// PIT (programmable interval timer) ports
+#define TIMER_PIT_CHANNEL0 0x40 // channel 0 is wired to IRQ 0
+#define TIMER_PIT_COMMAND 0x43
+#define TIMER_PIT_MODE_RATE 0b00110100 // channel 0, lobyte/hibyte access, mode 2 (rate generator), binary
+
+#define TIMER_PIT_FREQUENCY 1193182 // Hz (the PIT's input clock, which gets divided down)
+
+// timer wheel: 256 one-tick slots, then 3 levels of 64 coarser slots (each slot of a level spans a whole lap of the one below)
+#define TIMER_WHEEL_ROOT_BITS 8
+#define TIMER_WHEEL_LEVEL_BITS 6
+#define TIMER_WHEEL_LEVELS 3
+#define TIMER_WHEEL_MAX_DELAY ((1 << (TIMER_WHEEL_ROOT_BITS + TIMER_WHEEL_LEVELS * TIMER_WHEEL_LEVEL_BITS)) - 1) // in ticks (~18 hours @ 1 kHz)
+
+// a one-shot callback, run from the timer interrupt (so it mustn't block)
+typedef void(*TIMER_FUNCTION)( void* data );
+struct timer {
+    uint32_t expires; // tick it fires on (wraps, so always compare differences)
+    TIMER_FUNCTION function;
+    void* data;
+    struct timer *next, *prev, **slot; // slot links (slot = NULL when it isn't pending)
+};
+
+// (mirrored in programs/stdlib/peachos.h, since the time syscalls copy it to & from userland)
+struct timespec { uint32_t tv_sec, tv_nsec; };
+
+void timer_init( uint32_t frequency ); // programs the PIT to interrupt 'frequency' times per second
+void timer_tick(); // called on every timer interrupt (fires any expired timers)
+uint64_t timer_ticks(); // monotonic count of ticks since timer_init
+uint32_t timer_frequency(); // ticks per second (what the PIT actually runs at, after rounding the divisor)
+
+// timers (O(1) to add, cancel & advance per tick)
+void timer_add( struct timer* timer, uint32_t delay, TIMER_FUNCTION function, void* data ); // 'delay' in ticks (capped @ TIMER_WHEEL_MAX_DELAY)
+void timer_cancel( struct timer* timer );
+
+// blocks the current task for at least this long
+void timer_sleep_ticks( uint32_t ticks );
+void timer_sleep_ms( uint32_t ms );
+int timer_nanosleep( const struct timespec* duration );